@@ -0,0 +1,156 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Commentary:
+ * Compares walking the pointer based AST (`ast::Ast`) against the flat,
+ * struct of arrays AST (`ast::flat::FlatAst`). Each walk visits all the
+ * nodes and counts the symbols and the list elements, which is the kind
+ * of work that the semantic analyzer and the codegen do.
+ */
+
+#include "ast/ast.h"
+#include "ast/flat.h"
+#include "reader.h"
+
+#include <benchmark/benchmark.h>
+
+#include <llvm/Support/Casting.h>
+
+#include <string>
+
+namespace {
+using namespace serene;
+
+/// Generate `n` top level forms with a bit of nesting in each
+std::string generateForms(int64_t n) {
+  std::string src;
+
+  for (int64_t i = 0; i < n; i++) {
+    src += "(defn fn-name (x y) (let (a (+ x 1) b (* y 2)) (foo a b 3 -4)))\n";
+  }
+
+  return src;
+}
+
+ast::Ast readOrDie(const std::string &src) {
+  auto maybeAst = serene::read(src, "bench", std::nullopt);
+
+  if (!maybeAst) {
+    llvm::report_fatal_error(maybeAst.takeError());
+  }
+
+  return std::move(*maybeAst);
+}
+
+struct Counters {
+  size_t symbols  = 0;
+  size_t elements = 0;
+};
+
+void walk(const ast::Expression &node, Counters &c) {
+  if (llvm::isa<ast::Symbol>(&node)) {
+    c.symbols++;
+    return;
+  }
+
+  if (const auto *list = llvm::dyn_cast<ast::List>(&node)) {
+    c.elements += list->elements.size();
+    for (const auto &elem : list->elements) {
+      walk(*elem, c);
+    }
+  }
+}
+
+void walk(const ast::flat::FlatAst &tree, ast::flat::NodeID id, Counters &c) {
+  switch (tree.getKind(id)) {
+  case TypeID::SYMBOL:
+    c.symbols++;
+    break;
+
+  case TypeID::LIST: {
+    auto size = tree.getNumOfChildren(id);
+    c.elements += size;
+
+    if (size == 0) {
+      break;
+    }
+
+    auto first = tree.getFirstChild(id);
+    for (auto i = first; i < first + size; i++) {
+      walk(tree, i, c);
+    }
+    break;
+  }
+  default:
+    break;
+  }
+}
+
+void BM_PointerTreeWalk(benchmark::State &state) {
+  auto tree = readOrDie(generateForms(state.range(0)));
+
+  for (auto _ : state) {
+    Counters c;
+    for (const auto &node : tree) {
+      walk(*node, c);
+    }
+    benchmark::DoNotOptimize(c);
+  }
+}
+
+/// Visits the nodes in the tree order, like a codegen walk would do
+void BM_FlatTreeWalk(benchmark::State &state) {
+  auto ast  = readOrDie(generateForms(state.range(0)));
+  auto tree = ast::flat::FlatAst::build(ast, "bench", std::nullopt);
+
+  for (auto _ : state) {
+    Counters c;
+    for (ast::flat::NodeID i = 0; i < tree->getNumOfRoots(); i++) {
+      walk(*tree, i, c);
+    }
+    benchmark::DoNotOptimize(c);
+  }
+}
+
+/// Streams through the node table for the passes that don't need the
+/// tree order
+void BM_FlatLinearWalk(benchmark::State &state) {
+  auto ast  = readOrDie(generateForms(state.range(0)));
+  auto tree = ast::flat::FlatAst::build(ast, "bench", std::nullopt);
+
+  for (auto _ : state) {
+    Counters c;
+    auto kinds = tree->getKinds();
+
+    for (ast::flat::NodeID i = 0; i < kinds.size(); i++) {
+      if (kinds[i] == TypeID::SYMBOL) {
+        c.symbols++;
+      } else {
+        c.elements += tree->getNumOfChildren(i);
+      }
+    }
+    benchmark::DoNotOptimize(c);
+  }
+}
+
+} // namespace
+
+BENCHMARK(BM_PointerTreeWalk)->RangeMultiplier(8)->Range(8, 1 << 15);
+BENCHMARK(BM_FlatTreeWalk)->RangeMultiplier(8)->Range(8, 1 << 15);
+BENCHMARK(BM_FlatLinearWalk)->RangeMultiplier(8)->Range(8, 1 << 15);
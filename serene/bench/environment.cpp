@@ -0,0 +1,140 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Commentary:
+ * Measures the symbol resolution through a chain of nested lexical scopes
+ * (`Environment`s), e.g. a deeply nested `let` or closures inside of
+ * closures. Each scope has a few bindings of its own and the lookups
+ * resolve a symbol of the innermost scope, a symbol of the root scope and
+ * a symbol that is not bound at all.
+ *
+ * The `BM_Resolve*` ones do the same via `ScopeResolver` with the same
+ * chain of scopes, by name and by the interned `NameID` of the name.
+ */
+
+#include "ast/ast.h"
+#include "environment.h"
+#include "scopes.h"
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+using namespace serene;
+
+using Env = Environment<ast::Node>;
+
+constexpr int BINDINGS_PER_SCOPE = 4;
+
+/// Create a chain of `depth` scopes. The first one is the root scope.
+std::vector<std::unique_ptr<Env>> makeScopes(int64_t depth) {
+  std::vector<std::unique_ptr<Env>> scopes;
+  scopes.reserve(static_cast<size_t>(depth));
+
+  for (int64_t i = 0; i < depth; i++) {
+    auto *parent = scopes.empty() ? nullptr : scopes.back().get();
+    scopes.push_back(std::make_unique<Env>(parent));
+
+    for (int j = 0; j < BINDINGS_PER_SCOPE; j++) {
+      auto name = "sym-" + std::to_string(i) + "-" + std::to_string(j);
+      auto loc  = LocationRange::UnknownLocation("bench");
+      UNUSED(scopes.back()->insert_symbol(
+          name, ast::make<ast::Symbol>(loc, name, "bench")));
+    }
+  }
+
+  return scopes;
+}
+
+void lookup(benchmark::State &state, const std::string &key) {
+  auto scopes = makeScopes(state.range(0));
+  auto &inner = *scopes.back();
+
+  for (auto _ : state) {
+    auto *value = inner.lookup(key);
+    benchmark::DoNotOptimize(value);
+  }
+}
+
+void BM_LookupInnermost(benchmark::State &state) {
+  lookup(state, "sym-" + std::to_string(state.range(0) - 1) + "-0");
+}
+
+void BM_LookupRoot(benchmark::State &state) { lookup(state, "sym-0-0"); }
+
+void BM_LookupUnbound(benchmark::State &state) { lookup(state, "unbound"); }
+
+/// Open the same chain of scopes as `makeScopes` in the given \p resolver
+void openScopes(ScopeResolver &resolver, int64_t depth) {
+  for (int64_t i = 0; i < depth; i++) {
+    resolver.pushScope();
+
+    for (int j = 0; j < BINDINGS_PER_SCOPE; j++) {
+      resolver.bind("sym-" + std::to_string(i) + "-" + std::to_string(j));
+    }
+  }
+}
+
+void BM_ResolveRoot(benchmark::State &state) {
+  ScopeTable table;
+  ScopeResolver resolver(table);
+  openScopes(resolver, state.range(0));
+
+  for (auto _ : state) {
+    auto r = resolver.resolve("sym-0-0");
+    benchmark::DoNotOptimize(r);
+  }
+}
+
+void BM_ResolveRootByID(benchmark::State &state) {
+  ScopeTable table;
+  ScopeResolver resolver(table);
+  openScopes(resolver, state.range(0));
+
+  auto id = table.intern("sym-0-0");
+
+  for (auto _ : state) {
+    auto r = resolver.resolve(id);
+    benchmark::DoNotOptimize(r);
+  }
+}
+
+void BM_ResolveUnbound(benchmark::State &state) {
+  ScopeTable table;
+  ScopeResolver resolver(table);
+  openScopes(resolver, state.range(0));
+
+  for (auto _ : state) {
+    auto r = resolver.resolve("unbound");
+    benchmark::DoNotOptimize(r);
+  }
+}
+
+} // namespace
+
+// The argument is the depth of the scope chain
+BENCHMARK(BM_LookupInnermost)->RangeMultiplier(4)->Range(1, 1024);
+BENCHMARK(BM_LookupRoot)->RangeMultiplier(4)->Range(1, 1024);
+BENCHMARK(BM_LookupUnbound)->RangeMultiplier(4)->Range(1, 1024);
+BENCHMARK(BM_ResolveRoot)->RangeMultiplier(4)->Range(1, 1024);
+BENCHMARK(BM_ResolveRootByID)->RangeMultiplier(4)->Range(1, 1024);
+BENCHMARK(BM_ResolveUnbound)->RangeMultiplier(4)->Range(1, 1024);
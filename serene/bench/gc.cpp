@@ -0,0 +1,120 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Commentary:
+ * The cost of the allocation fast path with short lived objects and the
+ * pauses of the minor and major collections with a live vector of the
+ * given size.
+ *
+ * `BM_GCAllocateThreaded` allocates from several threads at once. Each
+ * thread bumps its own allocation buffer, so the throughput should grow
+ * almost linearly with the number of threads (up to the number of cores).
+ */
+
+#include "runtime/gc.h"
+#include "runtime/vector.h"
+
+#include <benchmark/benchmark.h>
+
+namespace {
+using namespace serene::runtime;
+
+/// Allocate a boxed number
+Value makeNumber(int64_t n) {
+  auto *num = allocate<Number>();
+  new (num) Number{n};
+
+  auto *o = allocate<Object>();
+  new (o) Object{getTypeIndex(TypeID::NUMBER), num};
+  return makeObject(o);
+}
+
+Vector makeNumbers(int64_t n) {
+  TransientVector t(emptyVector());
+
+  for (int64_t i = 0; i < n; i++) {
+    t.conj(makeNumber(i));
+  }
+
+  return t.persistent();
+}
+
+void BM_GCAllocate(benchmark::State &state) {
+  int64_t i = 0;
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(makeNumber(i++));
+    // Nothing is live, so it only releases the nursery once it's full
+    __serene_gc_safepoint();
+  }
+
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_GCAllocateThreaded(benchmark::State &state) {
+  // The other threads only use the heap in the loop, so the collection
+  // doesn't wait for them. There's no safepoint in the loop, so nothing
+  // collects while they allocate.
+  if (state.thread_index() == 0) {
+    collect();
+  }
+
+  int64_t i = 0;
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(makeNumber(i++));
+  }
+
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_GCMinorCollection(benchmark::State &state) {
+  for (auto _ : state) {
+    state.PauseTiming();
+    // All the nodes and the numbers are young
+    Root<Vector> v(makeNumbers(state.range(0)));
+    state.ResumeTiming();
+
+    collect();
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_GCMajorCollection(benchmark::State &state) {
+  Root<Vector> v(makeNumbers(state.range(0)));
+  collect();
+
+  for (auto _ : state) {
+    collect(true);
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+} // namespace
+
+BENCHMARK(BM_GCAllocate);
+// Nothing collects the garbage in the loop, so the iterations are capped
+BENCHMARK(BM_GCAllocateThreaded)
+    ->ThreadRange(1, 8)
+    ->Iterations(1 << 18)
+    ->UseRealTime();
+BENCHMARK(BM_GCMinorCollection)->RangeMultiplier(32)->Range(32, 1 << 15);
+BENCHMARK(BM_GCMajorCollection)->RangeMultiplier(32)->Range(32, 1 << 20);
@@ -0,0 +1,145 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Commentary:
+ * Compares `map` and `reduce` over the chunked runtime `List` against a
+ * classic linked list of cons cells (one heap cell per element) with 1M
+ * fixnums. `map` increments each element and `reduce` sums them up.
+ */
+
+#include "runtime/heap.h"
+#include "runtime/list.h"
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+namespace {
+using namespace serene::runtime;
+
+constexpr int64_t NUM_OF_ELEMENTS = 1 << 20;
+
+// The GC only collects at the safepoints and there's none in these loops,
+// so we have to limit the number of iterations of the benchmarks that
+// allocate.
+constexpr int64_t MAX_ALLOCATING_ITERATIONS = 64;
+
+Value inc(Value v) { return makeFixnum(getFixnum(v) + 1); }
+Value add(Value a, Value b) { return makeFixnum(getFixnum(a) + getFixnum(b)); }
+
+// Chunked list ===============================================================
+List makeChunkedList(int64_t n) {
+  std::vector<Value> elements;
+  elements.reserve(static_cast<size_t>(n));
+
+  for (int64_t i = 0; i < n; i++) {
+    elements.push_back(makeFixnum(i));
+  }
+
+  return makeList(elements);
+}
+
+void BM_ChunkedListMap(benchmark::State &state) {
+  auto l = makeChunkedList(state.range(0));
+
+  for (auto _ : state) {
+    auto result = map(l, inc);
+    benchmark::DoNotOptimize(result);
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_ChunkedListReduce(benchmark::State &state) {
+  auto l = makeChunkedList(state.range(0));
+
+  for (auto _ : state) {
+    auto result = reduce(l, makeFixnum(0), add);
+    benchmark::DoNotOptimize(result);
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Cons cells =================================================================
+struct Cell {
+  Value first;
+  const Cell *rest;
+};
+
+const Cell *makeCells(int64_t n) {
+  const Cell *head = nullptr;
+
+  for (int64_t i = n - 1; i >= 0; i--) {
+    auto *cell  = allocate<Cell>(Layout::Values);
+    cell->first = makeFixnum(i);
+    cell->rest  = head;
+    head        = cell;
+  }
+
+  return head;
+}
+
+void BM_ConsCellsMap(benchmark::State &state) {
+  const auto *cells = makeCells(state.range(0));
+
+  for (auto _ : state) {
+    Cell *head  = nullptr;
+    Cell **tail = &head;
+
+    for (const auto *c = cells; c != nullptr; c = c->rest) {
+      auto *cell  = allocate<Cell>(Layout::Values);
+      cell->first = inc(c->first);
+      cell->rest  = nullptr;
+      *tail       = cell;
+      tail        = const_cast<Cell **>(&cell->rest);
+    }
+
+    benchmark::DoNotOptimize(head);
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_ConsCellsReduce(benchmark::State &state) {
+  const auto *cells = makeCells(state.range(0));
+
+  for (auto _ : state) {
+    auto acc = makeFixnum(0);
+
+    for (const auto *c = cells; c != nullptr; c = c->rest) {
+      acc = add(acc, c->first);
+    }
+
+    benchmark::DoNotOptimize(acc);
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+} // namespace
+
+BENCHMARK(BM_ChunkedListMap)
+    ->Arg(NUM_OF_ELEMENTS)
+    ->Iterations(MAX_ALLOCATING_ITERATIONS);
+BENCHMARK(BM_ChunkedListReduce)->Arg(NUM_OF_ELEMENTS);
+BENCHMARK(BM_ConsCellsMap)
+    ->Arg(NUM_OF_ELEMENTS)
+    ->Iterations(MAX_ALLOCATING_ITERATIONS);
+BENCHMARK(BM_ConsCellsReduce)->Arg(NUM_OF_ELEMENTS);
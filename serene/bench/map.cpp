@@ -0,0 +1,159 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Commentary:
+ * Lookups in the runtime `Map` with string and keyword keys against
+ * `llvm::StringMap` and building a map one `assoc` at a time against
+ * building it via a `TransientMap`.
+ */
+
+#include "runtime/heap.h"
+#include "runtime/map.h"
+#include "runtime/string.h"
+
+#include <llvm/ADT/StringMap.h>
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+using namespace serene::runtime;
+
+// The GC only collects at the safepoints and there's none in these loops,
+// so we have to limit the number of iterations of the benchmarks that
+// allocate.
+constexpr int64_t MAX_ALLOCATING_ITERATIONS = 64;
+
+/// Box the given string in a runtime string. The string has to outlive the
+/// returned value.
+Value boxString(const std::string &s) {
+  const auto *str = makeStaticString(s);
+
+  auto *o = allocate<Object>();
+  new (o) Object{getTypeIndex(TypeID::STRING), str};
+  return makeObject(o);
+}
+
+std::vector<std::string> makeNames(int64_t n) {
+  std::vector<std::string> names;
+  names.reserve(static_cast<size_t>(n));
+
+  for (int64_t i = 0; i < n; i++) {
+    names.push_back("some-ns/some-name-" + std::to_string(i));
+  }
+
+  return names;
+}
+
+void BM_MapLookupString(benchmark::State &state) {
+  auto names = makeNames(state.range(0));
+  std::vector<Value> probes;
+  TransientMap t(emptyMap());
+
+  for (size_t i = 0; i < names.size(); i++) {
+    t.assoc(boxString(names[i]), makeFixnum(static_cast<int64_t>(i)));
+    // Look up with a different object with the same content, just like a
+    // string that comes from the user
+    probes.push_back(boxString(names[i]));
+  }
+
+  auto m = t.persistent();
+  std::mt19937 rng(42);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(lookup(m, probes[rng() % probes.size()]));
+  }
+}
+
+void BM_StringMapLookup(benchmark::State &state) {
+  auto names = makeNames(state.range(0));
+  llvm::StringMap<Value> m;
+
+  for (size_t i = 0; i < names.size(); i++) {
+    m[names[i]] = makeFixnum(static_cast<int64_t>(i));
+  }
+
+  std::mt19937 rng(42);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(m.find(names[rng() % names.size()]));
+  }
+}
+
+void BM_MapLookupKeyword(benchmark::State &state) {
+  auto n = static_cast<uint32_t>(state.range(0));
+  TransientMap t(emptyMap());
+
+  for (uint32_t i = 0; i < n; i++) {
+    t.assoc(makeKeyword(i), makeFixnum(i));
+  }
+
+  auto m = t.persistent();
+  std::mt19937 rng(42);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(lookup(m, makeKeyword(rng() % n)));
+  }
+}
+
+void BM_MapAssoc(benchmark::State &state) {
+  for (auto _ : state) {
+    auto m = emptyMap();
+
+    for (int64_t i = 0; i < state.range(0); i++) {
+      m = assoc(m, makeFixnum(i), makeFixnum(i));
+    }
+
+    benchmark::DoNotOptimize(m);
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_MapAssocTransient(benchmark::State &state) {
+  for (auto _ : state) {
+    TransientMap t(emptyMap());
+
+    for (int64_t i = 0; i < state.range(0); i++) {
+      t.assoc(makeFixnum(i), makeFixnum(i));
+    }
+
+    auto m = t.persistent();
+    benchmark::DoNotOptimize(m);
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+} // namespace
+
+BENCHMARK(BM_MapLookupString)->RangeMultiplier(32)->Range(32, 1 << 20);
+BENCHMARK(BM_StringMapLookup)->RangeMultiplier(32)->Range(32, 1 << 20);
+BENCHMARK(BM_MapLookupKeyword)->RangeMultiplier(32)->Range(32, 1 << 20);
+BENCHMARK(BM_MapAssoc)
+    ->RangeMultiplier(32)
+    ->Range(32, 1 << 15)
+    ->Iterations(MAX_ALLOCATING_ITERATIONS);
+BENCHMARK(BM_MapAssocTransient)
+    ->RangeMultiplier(32)
+    ->Range(32, 1 << 20)
+    ->Iterations(MAX_ALLOCATING_ITERATIONS);
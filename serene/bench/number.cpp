@@ -0,0 +1,68 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Commentary:
+ * The fixnum fast path of the arithmetic and the bigint multiplication
+ * around `KARATSUBA_THRESHOLD`, where it switches from the schoolbook
+ * algorithm to Karatsuba.
+ */
+
+#include "runtime/gc.h"
+#include "runtime/number.h"
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+namespace {
+using namespace serene::runtime;
+
+/// Return a positive integer with the given number of 64 bit limbs
+Value makeBigInt(int64_t limbs) {
+  // 19 decimal digits fit in a limb
+  std::string digits(static_cast<size_t>(limbs) * 19, '7');
+  return parseInt(digits);
+}
+
+void BM_FixnumAdd(benchmark::State &state) {
+  auto a = makeInt(1);
+
+  for (auto _ : state) {
+    a = add(a, makeInt(3));
+    benchmark::DoNotOptimize(a);
+  }
+}
+
+void BM_BigIntMul(benchmark::State &state) {
+  Root<Value> a(makeBigInt(state.range(0)));
+  Root<Value> b(makeBigInt(state.range(0)));
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(mul(a.get(), b.get()));
+    // The product is garbage already, only the operands are live
+    __serene_gc_safepoint();
+  }
+
+  state.SetComplexityN(state.range(0));
+}
+
+} // namespace
+
+BENCHMARK(BM_FixnumAdd);
+BENCHMARK(BM_BigIntMul)->RangeMultiplier(2)->Range(4, 1 << 10)->Complexity();
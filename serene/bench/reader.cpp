@@ -0,0 +1,238 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Commentary:
+ * Measures the throughput of `serene::read`. Each benchmark reports:
+ *
+ * - `bytes_per_second`: The input size that we read per second (MB/s)
+ * - `forms`: The number of top level forms that we read per second
+ * - `allocs_per_form`: The number of heap allocations per top level form
+ *
+ * The inputs are the example code in `resources/benchmarks/parsers` (scaled
+ * by repeating it) and a set of synthetic generators that stress different
+ * parts of the reader. `BM_ReadExampleCodeParallel` reads the same input
+ * as `BM_ReadExampleCode` via `readParallel` on all the cores.
+ *
+ * Use the `serene-bench-report` target to run all of them and get a JSON
+ * report.
+ */
+
+#include "reader.h"
+
+#include <benchmark/benchmark.h>
+
+#include <llvm/Support/MemoryBuffer.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+// Count the heap allocations of the whole process. It's not ideal
+// but the reader is the only thing that allocates in the hot loop.
+static std::atomic<size_t> numOfAllocations{0};
+
+void *operator new(size_t size) {
+  numOfAllocations.fetch_add(1, std::memory_order_relaxed);
+
+  if (void *p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t /*size*/) noexcept { std::free(p); }
+
+namespace {
+using namespace serene;
+
+// Generators =================================================================
+/// `(fn a0 a1 a2 ...)` with `width` elements
+std::string generateWideLists(int64_t n, int64_t width) {
+  std::string src;
+
+  for (int64_t i = 0; i < n; i++) {
+    src += "(fn";
+    for (int64_t j = 0; j < width; j++) {
+      src += " a" + std::to_string(j);
+    }
+    src += ")\n";
+  }
+
+  return src;
+}
+
+/// `(a (a (a ... )))` with `depth` levels of nesting
+std::string generateDeepNesting(int64_t n, int64_t depth) {
+  std::string src;
+
+  for (int64_t i = 0; i < n; i++) {
+    for (int64_t j = 0; j < depth; j++) {
+      src += "(a ";
+    }
+    src.append(static_cast<size_t>(depth), ')');
+    src += "\n";
+  }
+
+  return src;
+}
+
+/// `(def some.long.ns/xxxxxx... yyyyyy...)` with symbols of `length` chars
+std::string generateLongSymbols(int64_t n, int64_t length) {
+  std::string src;
+  std::string name(static_cast<size_t>(length), 'x');
+  std::string value(static_cast<size_t>(length), 'y');
+
+  for (int64_t i = 0; i < n; i++) {
+    src += "(def some.long.ns/" + name + " " + value + ")\n";
+  }
+
+  return src;
+}
+
+/// `(vals 1 -2 3.5 ...)` with `width` numbers
+std::string generateNumbers(int64_t n, int64_t width) {
+  std::string src;
+
+  for (int64_t i = 0; i < n; i++) {
+    src += "(vals";
+    for (int64_t j = 0; j < width; j++) {
+      switch (j % 3) {
+      case 0:
+        src += " " + std::to_string(j * 7919);
+        break;
+      case 1:
+        src += " -" + std::to_string(j);
+        break;
+      default:
+        src += " " + std::to_string(j) + ".25";
+      }
+    }
+    src += ")\n";
+  }
+
+  return src;
+}
+
+std::string loadExampleCode() {
+  auto buf = llvm::MemoryBuffer::getFile(SERENE_BENCH_CORPUS_DIR
+                                         "/parsers/example_code.srn");
+  if (!buf) {
+    return "";
+  }
+  return (*buf)->getBuffer().str();
+}
+
+// Benchmarks =================================================================
+using ReadFn = ast::MaybeAst (*)(llvm::StringRef, llvm::StringRef,
+                                 std::optional<llvm::StringRef>);
+
+ast::MaybeAst readOnAllThreads(llvm::StringRef input, llvm::StringRef ns,
+                               std::optional<llvm::StringRef> filename) {
+  return serene::readParallel(input, ns, filename);
+}
+
+void readInput(benchmark::State &state, const std::string &src,
+               ReadFn readFn = serene::read) {
+  if (src.empty()) {
+    state.SkipWithError("Empty input");
+    return;
+  }
+
+  size_t forms  = 0;
+  size_t allocs = 0;
+
+  for (auto _ : state) {
+    auto before   = numOfAllocations.load(std::memory_order_relaxed);
+    auto maybeAst = readFn(src, "bench", std::nullopt);
+    allocs += numOfAllocations.load(std::memory_order_relaxed) - before;
+
+    if (!maybeAst) {
+      // The reader doesn't support all the syntax in the corpus yet
+      llvm::consumeError(maybeAst.takeError());
+      state.SkipWithError("The reader failed to read the input");
+      return;
+    }
+
+    forms += maybeAst->size();
+    benchmark::DoNotOptimize(maybeAst);
+  }
+
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(src.size()));
+  state.counters["forms"] =
+      benchmark::Counter(static_cast<double>(forms), benchmark::Counter::kIsRate);
+  state.counters["allocs_per_form"] =
+      forms == 0 ? 0 : static_cast<double>(allocs) / static_cast<double>(forms);
+}
+
+void BM_ReadExampleCode(benchmark::State &state) {
+  static const std::string example = loadExampleCode();
+  std::string src;
+
+  for (int64_t i = 0; i < state.range(0); i++) {
+    src += example;
+  }
+
+  readInput(state, src);
+}
+
+void BM_ReadWideLists(benchmark::State &state) {
+  readInput(state, generateWideLists(state.range(0), state.range(1)));
+}
+
+void BM_ReadDeepNesting(benchmark::State &state) {
+  readInput(state, generateDeepNesting(state.range(0), state.range(1)));
+}
+
+void BM_ReadLongSymbols(benchmark::State &state) {
+  readInput(state, generateLongSymbols(state.range(0), state.range(1)));
+}
+
+void BM_ReadNumbers(benchmark::State &state) {
+  readInput(state, generateNumbers(state.range(0), state.range(1)));
+}
+
+void BM_ReadExampleCodeParallel(benchmark::State &state) {
+  static const std::string example = loadExampleCode();
+  std::string src;
+
+  for (int64_t i = 0; i < state.range(0); i++) {
+    src += example;
+  }
+
+  readInput(state, src, readOnAllThreads);
+}
+
+} // namespace
+
+// The first argument is the number of top level forms (or the number of
+// times we repeat the example code) and the second one is the size of each
+// form in the dimension that the generator stresses.
+BENCHMARK(BM_ReadExampleCode)->RangeMultiplier(8)->Range(1, 512);
+BENCHMARK(BM_ReadExampleCodeParallel)
+    ->RangeMultiplier(8)
+    ->Range(64, 4096)
+    ->UseRealTime();
+BENCHMARK(BM_ReadWideLists)->Ranges({{64, 1024}, {8, 512}});
+BENCHMARK(BM_ReadDeepNesting)->Ranges({{64, 1024}, {8, 256}});
+BENCHMARK(BM_ReadLongSymbols)->Ranges({{64, 1024}, {8, 1024}});
+BENCHMARK(BM_ReadNumbers)->Ranges({{64, 1024}, {8, 512}});
@@ -0,0 +1,89 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Commentary:
+ * Building a long string out of many short pieces, once via the ropes of
+ * `concat` and once by flattening it after each step, which is what a
+ * string without ropes has to do.
+ */
+
+#include "runtime/gc.h"
+#include "runtime/string.h"
+
+#include <benchmark/benchmark.h>
+
+namespace {
+using namespace serene::runtime;
+
+/// The piece is out of the GC heap, so it doesn't need a root
+const String *getPiece() {
+  static String piece = [] {
+    String s{};
+    s.len  = 24;
+    s.kind = SERENE_STRING_FLAT;
+    s.data = "abcdefghijklmnopqrstuvwx";
+    return s;
+  }();
+
+  return &piece;
+}
+
+void BM_StringConcat(benchmark::State &state) {
+  for (auto _ : state) {
+    const auto *s = makeString("");
+
+    for (int64_t i = 0; i < state.range(0); i++) {
+      s = concat(s, getPiece());
+    }
+
+    benchmark::DoNotOptimize(getBytes(s).data());
+    // Nothing is live anymore, so it only releases the nursery
+    __serene_gc_safepoint();
+  }
+
+  state.SetComplexityN(state.range(0));
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_StringConcatFlatten(benchmark::State &state) {
+  for (auto _ : state) {
+    const auto *s = makeString("");
+
+    for (int64_t i = 0; i < state.range(0); i++) {
+      s = concat(s, getPiece());
+      benchmark::DoNotOptimize(getBytes(s).data());
+    }
+
+    __serene_gc_safepoint();
+  }
+
+  state.SetComplexityN(state.range(0));
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+} // namespace
+
+BENCHMARK(BM_StringConcat)
+    ->RangeMultiplier(4)
+    ->Range(64, 1 << 14)
+    ->Complexity();
+BENCHMARK(BM_StringConcatFlatten)
+    ->RangeMultiplier(4)
+    ->Range(64, 1 << 12)
+    ->Complexity();
@@ -0,0 +1,95 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Commentary:
+ * Building a runtime `Vector` one `conj` at a time against building it via
+ * a `TransientVector`, and the random access via `nth`.
+ */
+
+#include "runtime/vector.h"
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+
+namespace {
+using namespace serene::runtime;
+
+// The GC only collects at the safepoints and there's none in these loops,
+// so we have to limit the number of iterations of the benchmarks that
+// allocate.
+constexpr int64_t MAX_ALLOCATING_ITERATIONS = 64;
+
+void BM_VectorConj(benchmark::State &state) {
+  for (auto _ : state) {
+    auto v = emptyVector();
+
+    for (int64_t i = 0; i < state.range(0); i++) {
+      v = conj(v, makeFixnum(i));
+    }
+
+    benchmark::DoNotOptimize(v);
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_VectorConjTransient(benchmark::State &state) {
+  for (auto _ : state) {
+    TransientVector t(emptyVector());
+
+    for (int64_t i = 0; i < state.range(0); i++) {
+      t.conj(makeFixnum(i));
+    }
+
+    auto v = t.persistent();
+    benchmark::DoNotOptimize(v);
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_VectorNth(benchmark::State &state) {
+  auto n = static_cast<uint32_t>(state.range(0));
+  TransientVector t(emptyVector());
+
+  for (uint32_t i = 0; i < n; i++) {
+    t.conj(makeFixnum(i));
+  }
+
+  auto v = t.persistent();
+  std::mt19937 rng(42);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(nth(v, rng() % n));
+  }
+}
+
+} // namespace
+
+// Each `conj` copies the tail, so keep the size reasonable
+BENCHMARK(BM_VectorConj)
+    ->RangeMultiplier(32)
+    ->Range(32, 1 << 15)
+    ->Iterations(MAX_ALLOCATING_ITERATIONS);
+BENCHMARK(BM_VectorConjTransient)
+    ->RangeMultiplier(32)
+    ->Range(32, 1 << 20)
+    ->Iterations(MAX_ALLOCATING_ITERATIONS);
+BENCHMARK(BM_VectorNth)->RangeMultiplier(32)->Range(32, 1 << 20);
@@ -0,0 +1,86 @@
+/* -*- C -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Commentary:
+ * The memory layout of the runtime values as plain constants. The codegen
+ * uses them to emit the loads, stores and tag checks in the JIT'd code and
+ * the runtime (`types.h`) checks its structs against them at compile time,
+ * so the two can't get out of sync.
+ */
+
+#ifndef SERENE_LAYOUT_H
+#define SERENE_LAYOUT_H
+
+// Value tags =================================================================
+#define SERENE_TAG_BITS 3
+#define SERENE_TAG_MASK 0x7
+
+#define SERENE_POINTER_TAG 0x0
+#define SERENE_FIXNUM_TAG  0x1
+#define SERENE_NIL_TAG     0x2
+#define SERENE_SYMBOL_TAG  0x4
+#define SERENE_KEYWORD_TAG 0x6
+
+// Type descriptors ===========================================================
+// Descriptors are stored in a global table indexed by the type index and
+// two of them fit in a cache line.
+#define SERENE_TYPE_DESCRIPTOR_SIZE 32
+
+#define SERENE_TYPE_ID_OFFSET      0
+#define SERENE_TYPE_FLAGS_OFFSET   4
+#define SERENE_TYPE_SIZE_OFFSET    8
+#define SERENE_TYPE_NAME_OFFSET    16
+#define SERENE_TYPE_METHODS_OFFSET 24
+
+#define SERENE_TYPE_FLAG_IMMEDIATE  0x1
+#define SERENE_TYPE_FLAG_COLLECTION 0x2
+
+// Objects ====================================================================
+#define SERENE_OBJECT_SIZE        16
+#define SERENE_OBJECT_TYPE_OFFSET 0
+#define SERENE_OBJECT_DATA_OFFSET 8
+
+// Strings ====================================================================
+// Strings up to this size keep their bytes inline (plus a NUL)
+#define SERENE_STRING_INLINE_SIZE 15
+
+#define SERENE_STRING_LEN_OFFSET   0
+#define SERENE_STRING_KIND_OFFSET  4
+#define SERENE_STRING_BYTES_OFFSET 8
+
+#define SERENE_STRING_INLINE 0
+#define SERENE_STRING_FLAT   1
+#define SERENE_STRING_ROPE   2
+
+// GC =========================================================================
+// Each GC object has a header right before its address
+#define SERENE_GC_HEADER_SIZE          8
+#define SERENE_GC_HEADER_SIZE_OFFSET   0
+#define SERENE_GC_HEADER_LAYOUT_OFFSET 4
+#define SERENE_GC_HEADER_FLAGS_OFFSET  5
+
+// Bigger objects don't go to the nursery
+#define SERENE_GC_LARGE_OBJECT_SIZE (8 * 1024)
+
+// The thread local allocation buffer. The JIT'd code bumps the cursor
+// inline and calls the runtime once it reaches the limit.
+#define SERENE_TLAB_CURSOR_OFFSET 0
+#define SERENE_TLAB_LIMIT_OFFSET  8
+
+#endif
@@ -31,6 +31,14 @@ enum class Type {
   TwoFloatPoints,
   InvalidCharacterForSymbol,
   EOFWhileScaningAList,
+  InvalidArtifact,
+  InvalidSerializedAst,
+  EOFWhileScaningAString,
+  InvalidEscapeSequence,
+  EOFAfterReaderMacro,
+  EOFWhileScaningAVector,
+  EOFWhileScaningAMap,
+  OddNumberOfFormsInMap,
   // This error has to be the final error at all time. DO NOT CHANGE IT!
   FINALERROR,
 };
@@ -42,6 +50,14 @@ static std::string errorMessages[static_cast<int>(Type::FINALERROR) + 1] = {
     "Invalid float number format",                      // TwoFloatPoints,
     "Invalid symbol format", // InvalidCharacterForSymbol
     "Reached the end of the file while scanning for a list", // EOFWhileScaningAList
+    "Invalid or corrupted namespace artifact", // InvalidArtifact
+    "Invalid or corrupted serialized AST",     // InvalidSerializedAst
+    "Reached the end of the file while scanning for a string", // EOFWhileScaningAString
+    "Invalid escape sequence in the string", // InvalidEscapeSequence
+    "Reached the end of the file while looking for the quoted form", // EOFAfterReaderMacro
+    "Reached the end of the file while scanning for a vector", // EOFWhileScaningAVector
+    "Reached the end of the file while scanning for a map", // EOFWhileScaningAMap
+    "A map needs an even number of forms", // OddNumberOfFormsInMap
 };
 } // namespace serene::errors
 #endif
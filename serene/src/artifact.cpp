@@ -0,0 +1,186 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "artifact.h"
+
+#include "errors.h"
+#include "utils.h"
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/Alignment.h>
+#include <llvm/Support/Endian.h>
+#include <llvm/Support/EndianStream.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/FormatVariadic.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/ToolOutputFile.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Support/xxhash.h>
+
+#include <cstring>
+
+namespace serene::artifact {
+
+namespace endian = llvm::support::endian;
+
+constexpr static size_t HEADER_SIZE         = 24;
+constexpr static size_t SECTION_ENTRY_SIZE  = 24;
+constexpr static unsigned SECTION_ALIGNMENT = 8;
+constexpr static auto NUM_SECTIONS =
+    static_cast<uint32_t>(SectionKind::FINALSECTION);
+
+static llvm::Error makeError(llvm::StringRef ns, const llvm::Twine &msg) {
+  return errors::make(errors::Type::InvalidArtifact,
+                      LocationRange::UnknownLocation(ns), msg.str());
+};
+
+uint64_t hashSource(llvm::StringRef src) { return llvm::xxHash64(src); };
+
+std::string getArtifactPath(llvm::StringRef srcFile) {
+  llvm::SmallString<MAX_PATH_SLOTS> path(srcFile);
+  llvm::sys::path::replace_extension(path, ARTIFACT_SUFFIX);
+  return std::string(path);
+};
+
+// ============================================================================
+// Artifact
+// ============================================================================
+llvm::Error Artifact::parse(llvm::StringRef ns) {
+  auto data = buffer->getBuffer();
+
+  if (data.size() < HEADER_SIZE ||
+      std::memcmp(data.data(), ARTIFACT_MAGIC, sizeof(ARTIFACT_MAGIC)) != 0) {
+    return makeError(ns, "Bad artifact header");
+  }
+
+  const auto *p = data.bytes_begin();
+
+  if (endian::read32le(p + 4) != ARTIFACT_VERSION) {
+    return makeError(ns, "Artifact version mismatch");
+  }
+
+  sourceHash         = endian::read64le(p + 8);
+  auto numOfSections = endian::read32le(p + 16);
+
+  if (numOfSections != NUM_SECTIONS ||
+      data.size() < HEADER_SIZE + (numOfSections * SECTION_ENTRY_SIZE)) {
+    return makeError(ns, "Bad section table");
+  }
+
+  for (uint32_t i = 0; i < numOfSections; i++) {
+    const auto *entry = p + HEADER_SIZE + (i * SECTION_ENTRY_SIZE);
+    auto kind         = endian::read32le(entry);
+    auto offset       = endian::read64le(entry + 8);
+    auto size         = endian::read64le(entry + 16);
+
+    if (kind >= NUM_SECTIONS || offset > data.size() ||
+        size > data.size() - offset) {
+      return makeError(ns, "Bad section entry");
+    }
+
+    sections[kind] = {offset, size};
+  }
+
+  return llvm::Error::success();
+};
+
+llvm::Expected<Artifact> Artifact::load(std::unique_ptr<llvm::MemoryBuffer> buf,
+                                        llvm::StringRef ns) {
+  Artifact a(std::move(buf));
+
+  if (auto err = a.parse(ns)) {
+    return err;
+  }
+
+  return a;
+};
+
+llvm::StringRef Artifact::getSection(SectionKind section) const {
+  auto [offset, size] = sections[static_cast<int>(section)];
+  return buffer->getBuffer().substr(offset, size);
+};
+
+llvm::Expected<ast::serialize::AstView>
+Artifact::getAstView(llvm::StringRef ns) const {
+  return ast::serialize::AstView::create(getSection(SectionKind::Ast), ns);
+};
+
+ast::MaybeAst Artifact::getAst(llvm::StringRef ns,
+                               std::optional<llvm::StringRef> filename) const {
+  auto view = getAstView(ns);
+  if (!view) {
+    return view.takeError();
+  }
+
+  return view->materialize(ns, filename);
+};
+
+// ============================================================================
+// Writer
+// ============================================================================
+llvm::Error write(llvm::StringRef path, llvm::StringRef ns, llvm::StringRef src,
+                  const ast::Ast &ast, llvm::StringRef obj) {
+  llvm::SmallString<0> astSection;
+  llvm::raw_svector_ostream astOS(astSection);
+
+  if (auto err = ast::serialize::serialize(ast, astOS, ns)) {
+    return err;
+  }
+
+  llvm::StringRef contents[NUM_SECTIONS] = {astSection, obj};
+
+  std::error_code ec;
+  llvm::ToolOutputFile file(path, ec, llvm::sys::fs::OF_None);
+
+  if (ec) {
+    return makeError(ns, llvm::formatv("Can't open '{0}': {1}", path,
+                                       ec.message()));
+  }
+
+  auto &os = file.os();
+  endian::Writer w(os, llvm::support::little);
+
+  os.write(ARTIFACT_MAGIC, sizeof(ARTIFACT_MAGIC));
+  w.write<uint32_t>(ARTIFACT_VERSION);
+  w.write<uint64_t>(hashSource(src));
+  w.write<uint32_t>(NUM_SECTIONS);
+  w.write<uint32_t>(0);
+
+  uint64_t offset = HEADER_SIZE + (NUM_SECTIONS * SECTION_ENTRY_SIZE);
+
+  for (uint32_t i = 0; i < NUM_SECTIONS; i++) {
+    offset = llvm::alignTo(offset, SECTION_ALIGNMENT);
+    w.write<uint32_t>(i);
+    w.write<uint32_t>(0);
+    w.write<uint64_t>(offset);
+    w.write<uint64_t>(contents[i].size());
+    offset += contents[i].size();
+  }
+
+  for (const auto &content : contents) {
+    os.write_zeros(llvm::offsetToAlignment(os.tell(),
+                                           llvm::Align(SECTION_ALIGNMENT)));
+    os << content;
+  }
+
+  file.keep();
+  ARTIFACT_LOG("Wrote the artifact of '" << ns << "' to: " << path);
+  return llvm::Error::success();
+};
+
+} // namespace serene::artifact
@@ -0,0 +1,152 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Commentary:
+ * A namespace artifact is the precompiled form of a namespace. Similar to
+ * precompiled headers or Clojure's AOT classes, it lets us skip the reader
+ * for namespaces that didn't change since the last time we read them.
+ *
+ * An artifact is a single binary file next to the source file of the
+ * namespace (`foo/bar.srn` -> `foo/bar.srnc`) with the following layout (all
+ * the integers are little endian):
+ *
+ * +--------------------------------------------------------------+
+ * | Header: magic | version | source hash | number of sections   |
+ * +--------------------------------------------------------------+
+ * | Section table: (kind, offset, size) * number of sections     |
+ * +--------------------------------------------------------------+
+ * | AST section: The serialized AST (look at `ast/serialize.h`)  |
+ * +--------------------------------------------------------------+
+ * | Object section: The compiled object of the namespace if any  |
+ * +--------------------------------------------------------------+
+ *
+ * The source hash is the `xxHash64` of the source file. An artifact is only
+ * valid as long as the hash of the source matches the one in the header.
+ *
+ * `Artifact` never copies the content of the file. It just holds on to the
+ * (usually memory mapped) buffer and hands out views into it. Since the AST
+ * section is pointer free, tools can walk it directly via `getAstView`.
+ */
+
+#ifndef ARTIFACT_H
+#define ARTIFACT_H
+
+#include "ast/ast.h"
+#include "ast/serialize.h"
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+#include <cstdint>
+#include <memory>
+
+#define ARTIFACT_LOG(...)                  \
+  DEBUG_WITH_TYPE("ARTIFACT", llvm::dbgs() \
+                                  << "[ARTIFACT]: " << __VA_ARGS__ << "\n");
+
+namespace serene::artifact {
+
+constexpr static const char *ARTIFACT_SUFFIX = "srnc";
+constexpr static const char ARTIFACT_MAGIC[] = {'S', 'R', 'N', 'A'};
+
+/// Bump this version whenever the layout of the artifact changes. Artifacts
+/// with a different version are ignored (and will be regenerated).
+constexpr static uint32_t ARTIFACT_VERSION = 2;
+
+enum class SectionKind : uint32_t {
+  Ast = 0,
+  Object,
+  // This has to be the last one at all times
+  FINALSECTION,
+};
+
+/// Return the hash of the given source \p src that we use to check whether
+/// an artifact is still valid for it or not.
+uint64_t hashSource(llvm::StringRef src);
+
+/// Return the path to the artifact of the given source file \p srcFile.
+std::string getArtifactPath(llvm::StringRef srcFile);
+
+/// A read only view over a namespace artifact.
+class Artifact {
+  std::unique_ptr<llvm::MemoryBuffer> buffer;
+
+  uint64_t sourceHash = 0;
+
+  /// The (offset, size) pair of each section in the buffer indexed by the
+  /// section kind.
+  std::pair<uint64_t, uint64_t>
+      sections[static_cast<int>(SectionKind::FINALSECTION)] = {};
+
+  explicit Artifact(std::unique_ptr<llvm::MemoryBuffer> buf)
+      : buffer(std::move(buf)){};
+
+  llvm::Error parse(llvm::StringRef ns);
+
+public:
+  Artifact(Artifact &&) noexcept            = default;
+  Artifact &operator=(Artifact &&) noexcept = default;
+  Artifact(const Artifact &)                = delete;
+  Artifact &operator=(const Artifact &)     = delete;
+
+  /// Validate the header and the section table of the given \p buf and
+  /// return an `Artifact` that owns it or an error if \p buf is not a valid
+  /// artifact. \p ns is only used for error reporting.
+  static llvm::Expected<Artifact> load(std::unique_ptr<llvm::MemoryBuffer> buf,
+                                       llvm::StringRef ns);
+
+  /// Return the hash of the source that this artifact is created from.
+  uint64_t getSourceHash() const { return sourceHash; };
+
+  /// Return a boolean indicating whether this artifact is created from the
+  /// given source \p src or not.
+  bool isValidFor(llvm::StringRef src) const {
+    return hashSource(src) == sourceHash;
+  };
+
+  /// Return the raw content of the given \p section.
+  llvm::StringRef getSection(SectionKind section) const;
+
+  /// Return a zero copy view over the AST section.
+  llvm::Expected<ast::serialize::AstView> getAstView(llvm::StringRef ns) const;
+
+  /// Decode the AST section and create the AST of the namespace \p ns. Just
+  /// like the reader, \p ns and \p filename have to outlive the returned AST.
+  ast::MaybeAst getAst(llvm::StringRef ns,
+                       std::optional<llvm::StringRef> filename) const;
+
+  /// Return the compiled object of the namespace. It will be empty if the
+  /// artifact is created before compiling the namespace.
+  llvm::StringRef getObject() const {
+    return getSection(SectionKind::Object);
+  };
+};
+
+using MaybeArtifact = llvm::Expected<Artifact>;
+
+/// Create an artifact out of the given \p ast that is read from the given
+/// \p src and write it to \p path. The \p obj is the compiled object of
+/// the namespace that can be empty.
+llvm::Error write(llvm::StringRef path, llvm::StringRef ns, llvm::StringRef src,
+                  const ast::Ast &ast, llvm::StringRef obj = "");
+
+} // namespace serene::artifact
+
+#endif
@@ -18,10 +18,23 @@
 
 #include "ast/ast.h"
 
-#include <llvm/Support/FormatVariadic.h>
+#include "ast/printer.h"
+
+#include <llvm/Support/Casting.h>
+#include <llvm/Support/raw_ostream.h>
 
 namespace serene::ast {
 
+// ============================================================================
+// Expression
+// ============================================================================
+std::string Expression::toString() const {
+  std::string s;
+  llvm::raw_string_ostream os(s);
+  Printer(os).print(*this);
+  return s;
+};
+
 // ============================================================================
 // Symbol
 // ============================================================================
@@ -48,10 +61,6 @@ Symbol::Symbol(Symbol &s) : Expression(s.location) {
 
 TypeID Symbol::getType() const { return TypeID::SYMBOL; };
 
-std::string Symbol::toString() const {
-  return llvm::formatv("<Symbol {0}/{1}>", nsName, name);
-}
-
 bool Symbol::classof(const Expression *e) {
   return e->getType() == TypeID::SYMBOL;
 };
@@ -67,62 +76,78 @@ Number::Number(Number &n) : Expression(n.location) { this->value = n.value; };
 
 TypeID Number::getType() const { return TypeID::NUMBER; };
 
-std::string Number::toString() const {
-  return llvm::formatv("<Number {0}{1}>", isNeg ? "-" : "", value);
-}
-
 bool Number::classof(const Expression *e) {
   return e->getType() == TypeID::NUMBER;
 };
 
+// ============================================================================
+// Collection
+// ============================================================================
+void Collection::append(Node &n) { elements.push_back(std::move(n)); }
+
+bool Collection::classof(const Expression *e) {
+  return isCollection(e->getType());
+};
+
 // ============================================================================
 // List
 // ============================================================================
-List::List(const LocationRange &loc) : Expression(loc){};
+List::List(const LocationRange &loc) : Collection(loc){};
 
-List::List(const LocationRange &loc, Ast &v) : Expression(loc) {
+List::List(const LocationRange &loc, Ast &v) : Collection(loc) {
   this->elements.swap(v);
   v.clear();
 };
 
-List::List(List &&l) noexcept : Expression(l.location) {
+List::List(List &&l) noexcept : Collection(l.location) {
   this->elements.swap(l.elements);
   l.elements.clear();
 };
 
 TypeID List::getType() const { return TypeID::LIST; };
 
-std::string List::toString() const {
-  std::string s{this->elements.empty() ? "-" : ""};
+bool List::classof(const Expression *e) {
+  return e->getType() == TypeID::LIST;
+};
 
-  for (const auto &n : this->elements) {
-    s = llvm::formatv("{0}, {1}", s, n->toString());
-  }
+// ============================================================================
+// Vector
+// ============================================================================
+Vector::Vector(const LocationRange &loc, size_t size) : Collection(loc) {
+  elements.reserve(size);
+};
 
-  return llvm::formatv("<List {0}>", s);
-}
+TypeID Vector::getType() const { return TypeID::VECTOR; };
 
-bool List::classof(const Expression *e) {
-  return e->getType() == TypeID::LIST;
+bool Vector::classof(const Expression *e) {
+  return e->getType() == TypeID::VECTOR;
 };
 
-void List::append(Node &n) { elements.push_back(std::move(n)); }
+// ============================================================================
+// Map
+// ============================================================================
+Map::Map(const LocationRange &loc, size_t size) : Collection(loc) {
+  elements.reserve(size);
+};
+
+TypeID Map::getType() const { return TypeID::MAP; };
+
+bool Map::classof(const Expression *e) { return e->getType() == TypeID::MAP; };
 // ============================================================================
 // String
 // ============================================================================
 String::String(const LocationRange &loc, llvm::StringRef v)
-    : Expression(loc), data(v.str()){};
+    : Expression(loc), storage(v.str()), data(storage){};
 
-String::String(String &s) : Expression(s.location), data(s.data){};
+String::String(const LocationRange &loc, llvm::StringRef v, bool borrow)
+    : Expression(loc), storage(borrow ? "" : v.str()),
+      data(borrow ? v : llvm::StringRef(storage)){};
 
-TypeID String::getType() const { return TypeID::STRING; };
+String::String(String &s)
+    : Expression(s.location), storage(s.storage),
+      data(s.isBorrowed() ? s.data : llvm::StringRef(storage)){};
 
-std::string String::toString() const {
-  const short truncateSize = 10;
-  return llvm::formatv(
-      "<String '{0}'>",
-      data.substr(0, data.size() >= truncateSize ? truncateSize : data.size()));
-}
+TypeID String::getType() const { return TypeID::STRING; };
 
 bool String::classof(const Expression *e) {
   return e->getType() == TypeID::STRING;
@@ -137,10 +162,6 @@ Keyword::Keyword(Keyword &s) : Expression(s.location) { this->name = s.name; };
 
 TypeID Keyword::getType() const { return TypeID::KEYWORD; };
 
-std::string Keyword::toString() const {
-  return llvm::formatv("<Keyword {0}>", name);
-}
-
 bool Keyword::classof(const Expression *e) {
   return e->getType() == TypeID::KEYWORD;
 };
@@ -157,14 +178,10 @@ Error::Error(Error &e) : Expression(e.location) {
   this->tag = std::move(e.tag);
 };
 
-TypeID Error::getType() const { return TypeID::KEYWORD; };
-
-std::string Error::toString() const {
-  return llvm::formatv("<Error {0}>", msg);
-}
+TypeID Error::getType() const { return TypeID::Error; };
 
 bool Error::classof(const Expression *e) {
-  return e->getType() == TypeID::KEYWORD;
+  return e->getType() == TypeID::Error;
 };
 
 // ============================================================================
@@ -174,25 +191,89 @@ Namespace::Namespace(const LocationRange &loc, llvm::StringRef name)
     : Namespace(loc, name, std::nullopt){};
 Namespace::Namespace(const LocationRange &loc, llvm::StringRef name,
                      std::optional<llvm::StringRef> filename)
-    : Expression(loc), name(name), filename(filename) {
-  createEnv(nullptr);
-};
+    : Expression(loc), name(name), filename(filename){};
 
-Namespace::SemanticEnv &Namespace::createEnv(SemanticEnv *parent) {
-  auto env = std::make_unique<SemanticEnv>(parent);
-  environments.push_back(std::move(env));
-
-  return *environments.back();
+ScopeID Namespace::createEnv(ScopeID parent) {
+  return environments.addScope(parent);
 };
 
 TypeID Namespace::getType() const { return TypeID::NS; };
 
-std::string Namespace::toString() const {
-  return llvm::formatv("<NS {0}>", name);
-}
-
 bool Namespace::classof(const Expression *e) {
   return e->getType() == TypeID::NS;
 };
 
+// ============================================================================
+// Compact forms
+// ============================================================================
+const Expression *
+walkBreadthFirst(const Ast &ast,
+                 llvm::function_ref<void(const CompactNode &)> fn) {
+  std::vector<const Expression *> queue;
+  queue.reserve(ast.size());
+
+  for (const auto &n : ast) {
+    queue.push_back(n.get());
+  }
+
+  // `queue` grows while we walk it. That's how we get the breadth first
+  // order and the contiguous children.
+  for (size_t i = 0; i < queue.size(); i++) {
+    CompactNode n;
+    n.node = queue[i];
+
+    switch (n.node->getType()) {
+    case TypeID::SYMBOL: {
+      const auto *sym = llvm::cast<Symbol>(n.node);
+      n.text          = sym->name;
+      n.secondaryText = sym->nsName;
+      break;
+    }
+    case TypeID::NUMBER: {
+      const auto *num = llvm::cast<Number>(n.node);
+      n.text          = num->value;
+      n.flags = static_cast<uint8_t>((num->isNeg ? NegativeNumber : 0) |
+                                     (num->isFloat ? FloatNumber : 0));
+      break;
+    }
+    case TypeID::STRING:
+      n.text = llvm::cast<String>(n.node)->data;
+      break;
+
+    case TypeID::KEYWORD:
+      n.text = llvm::cast<Keyword>(n.node)->name;
+      break;
+
+    case TypeID::Error: {
+      const auto *err = llvm::cast<Error>(n.node);
+      n.text          = err->msg;
+
+      if (err->tag) {
+        n.flags         = ErrorHasTag;
+        n.secondaryText = err->tag->name;
+      }
+      break;
+    }
+    case TypeID::LIST:
+    case TypeID::VECTOR:
+    case TypeID::MAP: {
+      const auto *coll = llvm::cast<Collection>(n.node);
+      n.firstChild     = static_cast<uint32_t>(queue.size());
+      n.numOfChildren  = static_cast<uint32_t>(coll->elements.size());
+
+      for (const auto &elem : coll->elements) {
+        queue.push_back(elem.get());
+      }
+      break;
+    }
+    default:
+      return n.node;
+    }
+
+    fn(n);
+  }
+
+  return nullptr;
+};
+
 } // namespace serene::ast
@@ -19,11 +19,13 @@
 #ifndef AST_AST_H
 #define AST_AST_H
 
-#include "environment.h"
 #include "location.h"
+#include "scopes.h"
 #include "serene/config.h"
 
+#include <llvm/ADT/STLExtras.h>
 #include <llvm/Support/Error.h>
+#include <mlir/Support/LogicalResult.h>
 
 #include <memory>
 
@@ -57,8 +59,10 @@ struct Expression {
   /// symbol.
   virtual TypeID getType() const = 0;
 
-  /// The AST representa htion of an expression
-  virtual std::string toString() const = 0;
+  /// Return the AST representation of the expression. It's just a shortcut
+  /// for printing the node via the `Printer` (look at `ast/printer.h`) into
+  /// a string.
+  std::string toString() const;
 
   /// Analyzes the semantics of current node and return a new node in case
   /// that we need to semantically rewrite the current node and replace it with
@@ -89,7 +93,6 @@ struct Symbol : public Expression {
   Symbol(Symbol &s);
 
   TypeID getType() const override;
-  std::string toString() const override;
 
   ~Symbol() = default;
 
@@ -111,7 +114,6 @@ struct Number : public Expression {
   Number(Number &n);
 
   TypeID getType() const override;
-  std::string toString() const override;
 
   ~Number() = default;
 
@@ -119,21 +121,73 @@ struct Number : public Expression {
 };
 
 // ============================================================================
-// List
+// Collection
+// The common base of the nodes that contain other nodes. Lists, vectors and
+// maps are all just a sequence of elements from the reader's point of view.
 // ============================================================================
-struct List : public Expression {
+
+/// Return a boolean indicating whether the nodes of the given type \p t are
+/// collections or not
+constexpr bool isCollection(TypeID t) {
+  return t == TypeID::LIST || t == TypeID::VECTOR || t == TypeID::MAP;
+};
+
+struct Collection : public Expression {
   Ast elements;
 
+  explicit Collection(const LocationRange &loc) : Expression(loc){};
+  void append(Node &n);
+
+  static bool classof(const Expression *e);
+};
+
+// ============================================================================
+// List
+// ============================================================================
+struct List : public Collection {
   explicit List(const LocationRange &loc);
   List(const LocationRange &loc, Ast &v);
   List(const List &l) = delete;
   List(List &&l) noexcept;
 
   TypeID getType() const override;
-  std::string toString() const override;
 
   ~List() = default;
-  void append(Node &n);
+
+  static bool classof(const Expression *e);
+};
+
+// ============================================================================
+// Vector
+// ============================================================================
+struct Vector : public Collection {
+  /// Create an empty vector with enough room for \p size elements
+  Vector(const LocationRange &loc, size_t size);
+  Vector(const Vector &v) = delete;
+
+  TypeID getType() const override;
+
+  ~Vector() = default;
+
+  static bool classof(const Expression *e);
+};
+
+// ============================================================================
+// Map
+// ============================================================================
+struct Map : public Collection {
+  /// Create an empty map with enough room for \p size elements. Keys and
+  /// values are stored one after another in the `elements`, so a map of
+  /// `n` entries has `2n` elements.
+  Map(const LocationRange &loc, size_t size);
+  Map(const Map &m) = delete;
+
+  TypeID getType() const override;
+
+  /// Return the number of the key/value pairs
+  size_t size() const { return elements.size() / 2; };
+
+  ~Map() = default;
 
   static bool classof(const Expression *e);
 };
@@ -142,13 +196,26 @@ struct List : public Expression {
 // String
 // ============================================================================
 struct String : public Expression {
-  std::string data;
+  /// The owned content of the string if any. It's only used for the strings
+  /// that can't point to their source, e.g. the ones with escape sequences.
+  std::string storage;
+
+  /// The content of the string. It either points to `storage` or directly
+  /// to the input buffer that the string is read from.
+  llvm::StringRef data;
 
+  /// Create a string node with a copy of the given value \p v.
   String(const LocationRange &loc, llvm::StringRef v);
+  /// Create a string node that points to \p v if \p borrow is true, without
+  /// copying it. In that case \p v has to outlive the node.
+  String(const LocationRange &loc, llvm::StringRef v, bool borrow);
   String(String &s);
 
+  /// Return a boolean indicating whether the content of this node is owned
+  /// by some other object (usually the input buffer of the reader).
+  bool isBorrowed() const { return data.data() != storage.data(); };
+
   TypeID getType() const override;
-  std::string toString() const override;
 
   ~String() = default;
 
@@ -165,7 +232,6 @@ struct Keyword : public Expression {
   Keyword(Keyword &s);
 
   TypeID getType() const override;
-  std::string toString() const override;
 
   ~Keyword() = default;
 
@@ -189,7 +255,6 @@ struct Error : public Expression {
   Error(Error &e);
 
   TypeID getType() const override;
-  std::string toString() const override;
 
   ~Error() = default;
 
@@ -200,30 +265,26 @@ struct Error : public Expression {
 // Namespace
 // ============================================================================
 struct Namespace : public Expression {
-  using SemanticEnv          = Environment<Node>;
-  using SemanticEnvPtr       = std::unique_ptr<SemanticEnv>;
-  using SemanticEnvironments = std::vector<SemanticEnvPtr>;
-
   std::string name;
   std::optional<std::string> filename;
 
   Ast tree;
 
-  SemanticEnvironments environments;
+  /// All the scopes of the namespace and their bindings in a flat table.
+  /// Look at `ScopeTable`.
+  ScopeTable environments;
 
   Namespace(const LocationRange &loc, llvm::StringRef name);
   Namespace(const LocationRange &loc, llvm::StringRef name,
             std::optional<llvm::StringRef> filename);
   Namespace(Namespace &s) = delete;
 
-  /// Create a new environment with the give \p parent as the parent,
-  /// push the environment to the internal environment storage and
-  /// return a reference to it. The namespace itself is the owner of
-  /// environments.
-  SemanticEnv &createEnv(SemanticEnv *parent);
+  /// Create a new environment with the give \p parent as the parent in
+  /// the scope table of the namespace and return its id.
+  ScopeID createEnv(ScopeID parent);
 
-  /// Return a referenece to the top level (root) environment of ns.
-  SemanticEnv &getRootEnv();
+  /// Return the id of the top level (root) environment of ns.
+  ScopeID getRootEnv() const { return ROOT_SCOPE; };
 
   /// Define a new binding in the root environment with the given \p name
   /// and the given \p node. Defining a new binding with a name that
@@ -241,7 +302,6 @@ struct Namespace : public Expression {
   Ast &getTree();
 
   TypeID getType() const override;
-  std::string toString() const override;
 
   ~Namespace() = default;
 
@@ -250,6 +310,39 @@ struct Namespace : public Expression {
 
 using MaybeNS = llvm::Expected<std::unique_ptr<Namespace>>;
 
+/// The per node flags of the compact representations of the AST, i.e. the
+/// serialized AST and `flat::FlatAst`.
+enum NodeFlags : uint8_t {
+  NegativeNumber = 1,
+  FloatNumber    = 1 << 1,
+  ErrorHasTag    = 1 << 2,
+};
+
+/// The fields of a node that the compact representations of the AST keep
+struct CompactNode {
+  const Expression *node = nullptr;
+  /// `NodeFlags`
+  uint8_t flags = 0;
+  /// The name of a symbol or keyword, the value of a number, the data of a
+  /// string or the message of an error
+  llvm::StringRef text;
+  /// The namespace name of a symbol or the tag of an error
+  llvm::StringRef secondaryText;
+  /// The children of a collection are the `numOfChildren` nodes right from
+  /// the `firstChild`th node of the walk on
+  uint32_t firstChild    = 0;
+  uint32_t numOfChildren = 0;
+};
+
+/// Walk the given \p ast in the breadth first order and call \p fn with the
+/// `CompactNode` of each node. So the top level forms come first and the
+/// children of each collection are contiguous. Return the first node that
+/// doesn't have a compact form (e.g. a namespace) or `nullptr` if there is
+/// none.
+const Expression *
+walkBreadthFirst(const Ast &ast,
+                 llvm::function_ref<void(const CompactNode &)> fn);
+
 /// Create a new `node` of type `T` and forwards any given parameter
 /// to the constructor of type `T`. This is the **official way** to create
 /// a new `Expression`. Here is an example:
@@ -0,0 +1,73 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ast/flat.h"
+
+#include <llvm/Support/ErrorHandling.h>
+
+namespace serene::ast::flat {
+
+uint32_t FlatAst::addText(llvm::StringRef s) {
+  auto [it, inserted] =
+      textIndex.try_emplace(s, static_cast<uint32_t>(texts.size()));
+
+  if (inserted) {
+    texts.push_back(it->getKey());
+  }
+
+  return it->second;
+};
+
+LocationRange FlatAst::getLocation(NodeID id) const {
+  const auto &loc = locations[id];
+  return LocationRange(
+      Location(ns, filename, nullptr, loc.startLine, loc.startCol),
+      Location(ns, filename, nullptr, loc.endLine, loc.endCol));
+};
+
+std::unique_ptr<FlatAst> FlatAst::build(const Ast &ast, llvm::StringRef ns,
+                                        std::optional<llvm::StringRef> fname) {
+  auto tree        = std::make_unique<FlatAst>(ns, fname);
+  tree->numOfRoots = ast.size();
+
+  const auto *unsupported = walkBreadthFirst(ast, [&](const CompactNode &n) {
+    const auto &loc = n.node->location;
+    auto kind       = n.node->getType();
+
+    tree->kinds.push_back(kind);
+    tree->flags.push_back(n.flags);
+    tree->locations.push_back({loc.start.line, loc.start.col, loc.end.line,
+                               loc.end.col});
+
+    if (isCollection(kind)) {
+      tree->first.push_back(n.firstChild);
+      tree->second.push_back(n.numOfChildren);
+    } else {
+      tree->first.push_back(tree->addText(n.text));
+      tree->second.push_back(tree->addText(n.secondaryText));
+    }
+  });
+
+  if (unsupported != nullptr) {
+    llvm_unreachable("Namespaces can't be part of a flat AST");
+  }
+
+  return tree;
+};
+
+} // namespace serene::ast::flat
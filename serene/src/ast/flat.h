@@ -0,0 +1,141 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Commentary:
+ * `FlatAst` is an alternative representation of the AST that is designed for
+ * the passes that walk the whole tree (e.g. semantic analysis and codegen).
+ * Instead of a tree of heap allocated `Expression`s, it is a table of nodes
+ * stored as a struct of arrays. Each node is just an index (`NodeID`) into
+ * the arrays and there is no virtual dispatch involved.
+ *
+ * Nodes are stored in the breadth first order, so:
+ * - The top level forms are the first `getNumOfRoots()` nodes.
+ * - The children of a list are a contiguous range of nodes.
+ * - Children always come after their parent.
+ *
+ * Passes that don't care about the structure can just stream through the
+ * arrays from start to end.
+ */
+
+#ifndef AST_FLAT_H
+#define AST_FLAT_H
+
+#include "ast/ast.h"
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringRef.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace serene::ast::flat {
+
+using NodeID = uint32_t;
+
+/// A compact version of the `LocationRange`. The namespace and the filename
+/// are the same for all the nodes of a `FlatAst`, so we don't need to keep
+/// them per node.
+struct CompactRange {
+  uint16_t startLine;
+  uint16_t startCol;
+  uint16_t endLine;
+  uint16_t endCol;
+};
+
+class FlatAst {
+  size_t numOfRoots = 0;
+
+  // The node table ===========================================================
+  std::vector<TypeID> kinds;
+  /// `NodeFlags`
+  std::vector<uint8_t> flags;
+  std::vector<CompactRange> locations;
+
+  /// For collections, the index of the first child and for other nodes the
+  /// main text (symbol name, number value, etc) as an index to `texts`.
+  std::vector<uint32_t> first;
+  /// For collections, the number of children and for other nodes the
+  /// secondary text (symbol's ns, error's tag) as an index to `texts`.
+  std::vector<uint32_t> second;
+
+  /// The interned strings that nodes refer to. The first one is always the
+  /// empty string.
+  std::vector<llvm::StringRef> texts;
+  llvm::StringMap<uint32_t> textIndex;
+
+  uint32_t addText(llvm::StringRef s);
+
+  llvm::StringRef ns;
+  std::optional<llvm::StringRef> filename;
+
+public:
+  FlatAst(llvm::StringRef ns, std::optional<llvm::StringRef> filename)
+      : ns(ns), filename(filename) {
+    addText("");
+  };
+
+  FlatAst(const FlatAst &)            = delete;
+  FlatAst &operator=(const FlatAst &) = delete;
+
+  /// Create a `FlatAst` out of the given \p ast.
+  static std::unique_ptr<FlatAst> build(const Ast &ast, llvm::StringRef ns,
+                                        std::optional<llvm::StringRef> fname);
+
+  /// Return the total number of the nodes
+  size_t size() const { return kinds.size(); };
+  size_t getNumOfRoots() const { return numOfRoots; };
+
+  // Column accessors for passes that stream through the table ==============
+  llvm::ArrayRef<TypeID> getKinds() const { return kinds; };
+  llvm::ArrayRef<CompactRange> getLocations() const { return locations; };
+
+  // Per node accessors =======================================================
+  TypeID getKind(NodeID id) const { return kinds[id]; };
+
+  LocationRange getLocation(NodeID id) const;
+
+  /// Return the name of a symbol or keyword, the value of a number, the
+  /// data of a string or the message of an error.
+  llvm::StringRef getText(NodeID id) const {
+    return isCollection(kinds[id]) ? "" : texts[first[id]];
+  };
+
+  /// Return the namespace name of a symbol or the tag of an error.
+  llvm::StringRef getSecondaryText(NodeID id) const {
+    return isCollection(kinds[id]) ? "" : texts[second[id]];
+  };
+
+  bool isNeg(NodeID id) const { return (flags[id] & NegativeNumber) != 0; };
+  bool isFloat(NodeID id) const { return (flags[id] & FloatNumber) != 0; };
+  bool hasTag(NodeID id) const { return (flags[id] & ErrorHasTag) != 0; };
+
+  /// Return the number of the children of a collection, zero otherwise
+  uint32_t getNumOfChildren(NodeID id) const {
+    return isCollection(kinds[id]) ? second[id] : 0;
+  };
+
+  /// Return the id of the first child of a collection. Only valid if the
+  /// collection has any children.
+  NodeID getFirstChild(NodeID id) const { return first[id]; };
+};
+
+} // namespace serene::ast::flat
+
+#endif
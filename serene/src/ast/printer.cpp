@@ -0,0 +1,128 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ast/printer.h"
+
+#include <llvm/Support/Casting.h>
+
+namespace serene::ast {
+
+constexpr static size_t STRING_TRUNCATE_SIZE = 10;
+
+void Printer::newLine(unsigned depth) {
+  os << '\n';
+  os.indent(depth * opts.indentWidth);
+};
+
+void Printer::printCollection(const Collection &coll, unsigned depth) {
+  switch (coll.getType()) {
+  case TypeID::VECTOR:
+    os << "<Vector";
+    break;
+  case TypeID::MAP:
+    os << "<Map";
+    break;
+  default:
+    os << "<List";
+  }
+
+  if (coll.elements.empty()) {
+    os << " ->";
+    return;
+  }
+
+  if (opts.maxDepth != 0 && depth >= opts.maxDepth) {
+    os << " ...>";
+    return;
+  }
+
+  bool first = true;
+
+  for (const auto &elem : coll.elements) {
+    if (opts.pretty) {
+      newLine(depth + 1);
+    } else {
+      os << (first ? " " : ", ");
+    }
+
+    first = false;
+    print(*elem, depth + 1);
+  }
+
+  os << ">";
+};
+
+void Printer::print(const Expression &node, unsigned depth) {
+  switch (node.getType()) {
+  case TypeID::SYMBOL: {
+    const auto &sym = llvm::cast<Symbol>(node);
+    os << "<Symbol " << sym.nsName << "/" << sym.name << ">";
+    break;
+  }
+  case TypeID::NUMBER:
+    // The value of a number already contains the sign
+    os << "<Number " << llvm::cast<Number>(node).value << ">";
+    break;
+
+  case TypeID::STRING: {
+    llvm::StringRef data = llvm::cast<String>(node).data;
+    os << "<String '" << data.take_front(STRING_TRUNCATE_SIZE) << "'>";
+    break;
+  }
+  case TypeID::KEYWORD:
+    os << "<Keyword " << llvm::cast<Keyword>(node).name << ">";
+    break;
+
+  case TypeID::Error:
+    os << "<Error " << llvm::cast<Error>(node).msg << ">";
+    break;
+
+  case TypeID::NS:
+    os << "<NS " << llvm::cast<Namespace>(node).name << ">";
+    break;
+
+  case TypeID::LIST:
+  case TypeID::VECTOR:
+  case TypeID::MAP:
+    printCollection(llvm::cast<Collection>(node), depth);
+    break;
+
+  default:
+    os << "<Unknown>";
+  }
+};
+
+void Printer::print(const Ast &ast) {
+  for (const auto &node : ast) {
+    print(*node);
+    os << '\n';
+  }
+};
+
+void print(const Ast &ast, llvm::raw_ostream &os, PrinterOptions opts) {
+  Printer p(os, opts);
+  p.print(ast);
+};
+
+void dump(Ast &ast) {
+  PrinterOptions opts;
+  opts.pretty = true;
+  print(ast, llvm::outs(), opts);
+};
+
+} // namespace serene::ast
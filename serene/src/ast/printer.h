@@ -0,0 +1,74 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Commentary:
+ * `Printer` writes the AST representation of the nodes directly to an
+ * `llvm::raw_ostream` without building any intermediate string. It is the
+ * only way to print the AST, `Expression::toString` and `ast::dump` are
+ * just thin wrappers around it.
+ *
+ * By default the output is a single line like:
+ *   <List <Symbol user/def>, <Symbol user/a>, <Number 1>>
+ *
+ * In the pretty mode every element of a list goes to its own line and gets
+ * indented with respect to the nesting level.
+ */
+
+#ifndef AST_PRINTER_H
+#define AST_PRINTER_H
+
+#include "ast/ast.h"
+
+#include <llvm/Support/raw_ostream.h>
+
+namespace serene::ast {
+
+struct PrinterOptions {
+  /// Print each element of a list in its own line
+  bool pretty = false;
+  /// Number of spaces to indent each nesting level in the pretty mode
+  unsigned indentWidth = 2;
+  /// Lists deeper than this will be elided as `<List ...>`. Zero means
+  /// no limit.
+  unsigned maxDepth = 0;
+};
+
+class Printer {
+  llvm::raw_ostream &os;
+  PrinterOptions opts;
+
+  void newLine(unsigned depth);
+  void printCollection(const Collection &coll, unsigned depth);
+
+public:
+  explicit Printer(llvm::raw_ostream &os, PrinterOptions opts = {})
+      : os(os), opts(opts){};
+
+  /// Print the given \p node which is at the given nesting level \p depth.
+  void print(const Expression &node, unsigned depth = 0);
+  /// Print all the top level forms of the given \p ast, one per line.
+  void print(const Ast &ast);
+};
+
+/// Print the given \p ast to \p os with the given \p opts
+void print(const Ast &ast, llvm::raw_ostream &os, PrinterOptions opts = {});
+
+} // namespace serene::ast
+
+#endif
@@ -0,0 +1,314 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ast/serialize.h"
+
+#include "errors.h"
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Support/FormatVariadic.h>
+
+#include <cstring>
+#include <limits>
+
+namespace serene::ast::serialize {
+
+using detail::Header;
+using detail::NodeRecord;
+
+static llvm::Error makeError(llvm::StringRef ns, const llvm::Twine &msg) {
+  return errors::make(errors::Type::InvalidSerializedAst,
+                      LocationRange::UnknownLocation(ns), msg.str());
+};
+
+// ============================================================================
+// Writer
+// ============================================================================
+namespace {
+class Writer {
+  llvm::StringRef ns;
+
+  llvm::StringMap<uint32_t> offsets;
+  llvm::SmallString<0> pool;
+
+  /// Add the given string \p s to the pool (if it's not there already)
+  /// and set the (offset, size) pair of it to the given fields.
+  void intern(llvm::StringRef s, detail::u32 &offset, detail::u32 &size) {
+    auto [it, inserted] =
+        offsets.try_emplace(s, static_cast<uint32_t>(pool.size()));
+
+    if (inserted) {
+      pool.append(s);
+    }
+
+    offset = it->second;
+    size   = static_cast<uint32_t>(s.size());
+  };
+
+public:
+  explicit Writer(llvm::StringRef ns) : ns(ns){};
+
+  llvm::Error write(const Ast &ast, llvm::raw_ostream &os) {
+    std::vector<NodeRecord> records;
+
+    const auto *unsupported = walkBreadthFirst(ast, [&](const CompactNode &n) {
+      const auto &loc = n.node->location;
+      NodeRecord r{};
+
+      r.kind      = static_cast<uint8_t>(n.node->getType());
+      r.flags     = n.flags;
+      r.startLine = loc.start.line;
+      r.startCol  = loc.start.col;
+      r.endLine   = loc.end.line;
+      r.endCol    = loc.end.col;
+
+      if (isCollection(n.node->getType())) {
+        r.firstOffset = n.firstChild;
+        r.firstSize   = n.numOfChildren;
+      } else {
+        intern(n.text, r.firstOffset, r.firstSize);
+        intern(n.secondaryText, r.secondOffset, r.secondSize);
+      }
+
+      records.push_back(r);
+    });
+
+    if (unsupported != nullptr) {
+      return makeError(ns, llvm::formatv("Can't serialize '{0}'",
+                                         unsupported->toString()));
+    }
+
+    if (records.size() > std::numeric_limits<uint32_t>::max() ||
+        pool.size() > std::numeric_limits<uint32_t>::max()) {
+      return makeError(ns, "The AST is too big to be serialized");
+    }
+
+    Header h{};
+    std::memcpy(h.magic, AST_MAGIC, sizeof(AST_MAGIC));
+    h.version        = AST_FORMAT_VERSION;
+    h.numOfNodes     = static_cast<uint32_t>(records.size());
+    h.numOfRoots     = static_cast<uint32_t>(ast.size());
+    h.stringPoolSize = static_cast<uint32_t>(pool.size());
+
+    os.write(reinterpret_cast<const char *>(&h), sizeof(h));
+    os.write(reinterpret_cast<const char *>(records.data()),
+             records.size() * sizeof(NodeRecord));
+    os << pool;
+
+    return llvm::Error::success();
+  };
+};
+} // namespace
+
+llvm::Error serialize(const Ast &ast, llvm::raw_ostream &os,
+                      llvm::StringRef ns) {
+  Writer w(ns);
+  return w.write(ast, os);
+};
+
+// ============================================================================
+// NodeView
+// ============================================================================
+LocationRange NodeView::getLocation(llvm::StringRef ns,
+                                    std::optional<llvm::StringRef> filename) const {
+  return LocationRange(
+      Location(ns, filename, nullptr, record->startLine, record->startCol),
+      Location(ns, filename, nullptr, record->endLine, record->endCol));
+};
+
+llvm::StringRef NodeView::getText() const {
+  if (isCollection(getType())) {
+    return "";
+  }
+  return view->strings.substr(record->firstOffset, record->firstSize);
+};
+
+llvm::StringRef NodeView::getSecondaryText() const {
+  return view->strings.substr(record->secondOffset, record->secondSize);
+};
+
+size_t NodeView::size() const {
+  return isCollection(getType()) ? static_cast<size_t>(record->firstSize) : 0;
+};
+
+NodeView NodeView::operator[](size_t i) const {
+  assert(i < size() && "Index out of range");
+  return NodeView(view, &view->nodes[record->firstOffset + i]);
+};
+
+// ============================================================================
+// AstView
+// ============================================================================
+llvm::Expected<AstView> AstView::create(llvm::StringRef buf,
+                                        llvm::StringRef ns) {
+  if (buf.size() < sizeof(Header)) {
+    return makeError(ns, "Buffer is too small for a serialized AST");
+  }
+
+  const auto *h = reinterpret_cast<const Header *>(buf.data());
+
+  if (std::memcmp(h->magic, AST_MAGIC, sizeof(AST_MAGIC)) != 0 ||
+      h->version != AST_FORMAT_VERSION) {
+    return makeError(ns, "Bad serialized AST header");
+  }
+
+  uint64_t numOfNodes = h->numOfNodes;
+  uint64_t tableSize  = numOfNodes * sizeof(NodeRecord);
+
+  if (h->numOfRoots > numOfNodes ||
+      buf.size() < sizeof(Header) + tableSize + h->stringPoolSize) {
+    return makeError(ns, "Truncated serialized AST");
+  }
+
+  AstView v;
+  v.nodes = llvm::ArrayRef(
+      reinterpret_cast<const NodeRecord *>(buf.data() + sizeof(Header)),
+      numOfNodes);
+  v.numOfRoots = h->numOfRoots;
+  v.strings    = buf.substr(sizeof(Header) + tableSize, h->stringPoolSize);
+
+  // Validate every record once here, so the `NodeView`s don't have to
+  auto inPool = [&](uint32_t offset, uint32_t size) {
+    return offset <= v.strings.size() && size <= v.strings.size() - offset;
+  };
+
+  for (uint64_t i = 0; i < numOfNodes; i++) {
+    const auto &r = v.nodes[i];
+
+    if (r.kind > static_cast<uint8_t>(TypeID::Error)) {
+      return makeError(ns, llvm::formatv("Bad node kind at {0}", i));
+    }
+
+    bool valid = true;
+
+    if (isCollection(static_cast<TypeID>(r.kind))) {
+      // Children have to come after their parent
+      valid = r.firstOffset > i && r.firstOffset <= numOfNodes &&
+              r.firstSize <= numOfNodes - r.firstOffset;
+    } else {
+      valid = inPool(r.firstOffset, r.firstSize) &&
+              inPool(r.secondOffset, r.secondSize);
+    }
+
+    if (!valid) {
+      return makeError(ns, llvm::formatv("Bad node record at {0}", i));
+    }
+  }
+
+  return v;
+};
+
+NodeView AstView::operator[](size_t i) const {
+  assert(i < numOfRoots && "Index out of range");
+  return NodeView(this, &nodes[i]);
+};
+
+static MaybeNode materializeNode(NodeView n, llvm::StringRef ns,
+                                 std::optional<llvm::StringRef> filename) {
+  auto loc = n.getLocation(ns, filename);
+
+  switch (n.getType()) {
+  case TypeID::SYMBOL: {
+    // The name is already splitted, so we can't pass it to the ctor
+    auto sym  = makeAndCast<Symbol>(loc, "", n.getSecondaryText());
+    sym->name = n.getText().str();
+    return sym;
+  }
+  case TypeID::NUMBER:
+    return make<Number>(loc, n.getText(), n.isNeg(), n.isFloat());
+
+  case TypeID::STRING:
+    return make<String>(loc, n.getText());
+
+  case TypeID::KEYWORD:
+    return make<Keyword>(loc, n.getText());
+
+  case TypeID::Error: {
+    std::unique_ptr<Keyword> tag;
+    if (n.hasTag()) {
+      tag = makeAndCast<Keyword>(loc, n.getSecondaryText());
+    }
+    return make<Error>(loc, std::move(tag), n.getText());
+  }
+  case TypeID::LIST:
+  case TypeID::VECTOR:
+  case TypeID::MAP: {
+    std::unique_ptr<Collection> coll;
+
+    if (n.getType() == TypeID::VECTOR) {
+      coll = makeAndCast<Vector>(loc, n.size());
+    } else if (n.getType() == TypeID::MAP) {
+      coll = makeAndCast<Map>(loc, n.size());
+    } else {
+      coll = makeAndCast<List>(loc);
+      coll->elements.reserve(n.size());
+    }
+
+    for (size_t i = 0; i < n.size(); i++) {
+      auto elem = materializeNode(n[i], ns, filename);
+      if (!elem) {
+        return elem.takeError();
+      }
+      coll->append(*elem);
+    }
+
+    return coll;
+  }
+  default:
+    return makeError(ns, "Can't materialize the node");
+  }
+};
+
+MaybeAst AstView::materialize(llvm::StringRef ns,
+                              std::optional<llvm::StringRef> filename) const {
+  Ast tree;
+  tree.reserve(size());
+
+  for (size_t i = 0; i < size(); i++) {
+    auto node = materializeNode((*this)[i], ns, filename);
+    if (!node) {
+      return node.takeError();
+    }
+    tree.push_back(std::move(*node));
+  }
+
+  return tree;
+};
+
+// ============================================================================
+// MappedAst
+// ============================================================================
+llvm::Expected<MappedAst> MappedAst::load(llvm::StringRef path,
+                                          llvm::StringRef ns) {
+  auto bufOrErr = llvm::MemoryBuffer::getFile(path, /*IsText=*/false,
+                                              /*RequiresNullTerminator=*/false);
+  if (auto ec = bufOrErr.getError()) {
+    return makeError(ns, llvm::formatv("Can't load '{0}': {1}", path,
+                                       ec.message()));
+  }
+
+  auto view = AstView::create((*bufOrErr)->getBuffer(), ns);
+  if (!view) {
+    return view.takeError();
+  }
+
+  return MappedAst(std::move(*bufOrErr), *view);
+};
+
+} // namespace serene::ast::serialize
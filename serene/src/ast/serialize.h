@@ -0,0 +1,202 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Commentary:
+ * A binary encoding of the reader output that can be persisted, memory mapped
+ * and shared between processes (the compiler, the LSP server, formatter,
+ * etc). The encoding has no pointers in it, everything is an offset or an
+ * index. So the buffer can be used directly without any decoding step.
+ *
+ * Layout (all the integers are little endian):
+ *
+ * +---------------------------------------------------------------+
+ * | Header: magic | version | number of nodes | number of roots   |
+ * |         size of the string pool                               |
+ * +---------------------------------------------------------------+
+ * | Node table: `NodeRecord` * number of nodes                    |
+ * +---------------------------------------------------------------+
+ * | String pool: The deduplicated strings that nodes refer to     |
+ * +---------------------------------------------------------------+
+ *
+ * Nodes are stored in the breadth first order. The first `number of roots`
+ * records are the top level forms and the children of each list are a
+ * contiguous range of records in the table. Children always come after
+ * their parent, so a valid table has no cycles.
+ *
+ * Use `serialize` to write an AST and `AstView` to read it back without
+ * copying anything. `AstView::materialize` recreates the `ast::Ast` if
+ * the owned tree is needed.
+ */
+
+#ifndef AST_SERIALIZE_H
+#define AST_SERIALIZE_H
+
+#include "ast/ast.h"
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/Endian.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <cstdint>
+#include <memory>
+
+namespace serene::ast::serialize {
+
+constexpr static const char AST_MAGIC[] = {'S', 'A', 'S', 'T'};
+// The node kinds are `TypeID`s, so adding a type changes the format
+constexpr static uint32_t AST_FORMAT_VERSION = 2;
+
+namespace detail {
+using u16 = llvm::support::ulittle16_t;
+using u32 = llvm::support::ulittle32_t;
+
+struct Header {
+  char magic[4];
+  u32 version;
+  u32 numOfNodes;
+  u32 numOfRoots;
+  u32 stringPoolSize;
+};
+
+/// The fixed size record of a node. The meaning of `first` and `second`
+/// depends on the kind of the node:
+///
+/// - Symbol:  first -> name, second -> namespace name
+/// - Number:  first -> value
+/// - String:  first -> data
+/// - Keyword: first -> name
+/// - Error:   first -> message, second -> the tag (keyword name)
+/// - List, Vector and Map:
+///            first -> (index of the first child, number of children)
+///
+/// Strings are (offset, size) pairs into the string pool.
+struct NodeRecord {
+  uint8_t kind;
+  /// `NodeFlags`
+  uint8_t flags;
+  u16 startLine;
+  u16 startCol;
+  u16 endLine;
+  u16 endCol;
+  u16 reserved;
+  u32 firstOffset;
+  u32 firstSize;
+  u32 secondOffset;
+  u32 secondSize;
+};
+
+static_assert(sizeof(Header) == 20, "Unexpected padding in the header");
+static_assert(sizeof(NodeRecord) == 28, "Unexpected padding in NodeRecord");
+} // namespace detail
+
+class AstView;
+
+/// A zero copy, read only view of a node inside of a serialized AST. It is
+/// a cheap value type (two pointers) and has to be passed by value.
+class NodeView {
+  const AstView *view;
+  const detail::NodeRecord *record;
+
+public:
+  NodeView(const AstView *view, const detail::NodeRecord *record)
+      : view(view), record(record){};
+
+  TypeID getType() const { return static_cast<TypeID>(record->kind); };
+
+  /// Return the location of the node. Just like the reader, \p ns and
+  /// \p filename have to outlive the returning value.
+  LocationRange getLocation(llvm::StringRef ns,
+                            std::optional<llvm::StringRef> filename) const;
+
+  /// Return the name of a symbol or keyword, the value of a number, the
+  /// data of a string or the message of an error.
+  llvm::StringRef getText() const;
+
+  /// Return the namespace name of a symbol or the tag of an error.
+  llvm::StringRef getSecondaryText() const;
+
+  bool isNeg() const { return (record->flags & NegativeNumber) != 0; };
+  bool isFloat() const { return (record->flags & FloatNumber) != 0; };
+  bool hasTag() const { return (record->flags & ErrorHasTag) != 0; };
+
+  /// Return the number of elements of a collection node, zero otherwise.
+  size_t size() const;
+  /// Return the \p i-th element of a collection node.
+  NodeView operator[](size_t i) const;
+};
+
+/// A zero copy, read only view over a serialized AST. It doesn't own the
+/// buffer and the buffer has to outlive the view and any `NodeView` created
+/// from it.
+class AstView {
+  llvm::ArrayRef<detail::NodeRecord> nodes;
+  size_t numOfRoots = 0;
+  llvm::StringRef strings;
+
+  AstView() = default;
+
+  friend class NodeView;
+
+public:
+  /// Validate the given \p buf and create a view over it. \p ns is only
+  /// used for error reporting.
+  static llvm::Expected<AstView> create(llvm::StringRef buf,
+                                        llvm::StringRef ns);
+
+  /// Return the number of the top level forms.
+  size_t size() const { return numOfRoots; };
+  /// Return the total number of nodes in the AST.
+  size_t getNumOfNodes() const { return nodes.size(); };
+
+  NodeView operator[](size_t i) const;
+
+  /// Recreate the `ast::Ast` out of the view. Just like the reader, \p ns and
+  /// \p filename have to outlive the returning AST.
+  MaybeAst materialize(llvm::StringRef ns,
+                       std::optional<llvm::StringRef> filename) const;
+};
+
+/// An `AstView` that owns its (memory mapped) buffer.
+class MappedAst {
+  std::unique_ptr<llvm::MemoryBuffer> buffer;
+  AstView view;
+
+  MappedAst(std::unique_ptr<llvm::MemoryBuffer> buf, AstView v)
+      : buffer(std::move(buf)), view(v){};
+
+public:
+  /// Memory map the serialized AST in the given \p path and create a view
+  /// over it.
+  static llvm::Expected<MappedAst> load(llvm::StringRef path,
+                                        llvm::StringRef ns);
+
+  const AstView &getView() const { return view; };
+};
+
+/// Serialize the given \p ast to the \p os. It returns an error if the
+/// \p ast contains a node that can't be serialized (e.g. a namespace).
+llvm::Error serialize(const Ast &ast, llvm::raw_ostream &os,
+                      llvm::StringRef ns);
+
+} // namespace serene::ast::serialize
+
+#endif
@@ -24,6 +24,8 @@
 #include <llvm/ADT/StringMap.h>
 #include <mlir/Support/LogicalResult.h>
 
+#include <utility>
+
 namespace serene {
 
 /// This class represents a classic lisp environment (or scope) that holds the
@@ -42,23 +44,31 @@ public:
   Environment() : parent(nullptr) {}
   explicit Environment(Environment *parent) : parent(parent){};
 
-  /// Look up the given `key` in the environment and return it.
-  std::optional<V> lookup(llvm::StringRef key) {
-    if (auto value = pairs.lookup(key)) {
-      return value;
+  /// Look up the given `key` in the environment and its parents and return
+  /// a pointer to the value or `nullptr` if it's not bound. The value is
+  /// owned by the environment and the pointer is valid as long as the
+  /// binding exists.
+  V *lookup(llvm::StringRef key) {
+    // Walk the chain in a loop, deep scopes shouldn't cost stack frames
+    for (auto *env = this; env != nullptr; env = env->parent) {
+      auto it = env->pairs.find(key);
+
+      if (it != env->pairs.end()) {
+        return &it->getValue();
+      }
     }
 
-    if (parent) {
-      return parent->lookup(key);
-    }
+    return nullptr;
+  };
 
-    return std::nullopt;
+  const V *lookup(llvm::StringRef key) const {
+    return const_cast<Environment *>(this)->lookup(key);
   };
 
   /// Insert the given `key` with the given `value` into the storage. This
   /// operation will shadow an aleady exist `key` in the parent environment
   mlir::LogicalResult insert_symbol(llvm::StringRef key, V value) {
-    auto result = pairs.insert_or_assign(key, value);
+    auto result = pairs.insert_or_assign(key, std::move(value));
     UNUSED(result);
     return mlir::success();
   };
@@ -0,0 +1,398 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "incremental_reader.h"
+
+#include <llvm/Support/Casting.h>
+#include <llvm/Support/Error.h>
+
+#include <algorithm>
+#include <cassert>
+
+namespace serene {
+
+/// How the parens of a region match up
+struct Balance {
+  /// The collections, strings and block comments that are open at the end
+  /// of the region
+  unsigned unclosed = 0;
+  /// The closing chars without a matching opening char in the region
+  unsigned extra = 0;
+  /// Whether the region ends in a line comment or with a quote prefix,
+  /// since both reach into whatever comes after the region
+  bool openEnd = false;
+
+  bool isBalanced() const { return unclosed == 0 && extra == 0; };
+};
+
+/// Return the `Balance` of the given \p region. Both counts matter on their
+/// own, e.g. `)(` has a net depth of zero but it still changes the forms on
+/// both sides of it.
+static Balance getBalance(llvm::StringRef region) {
+  Balance balance;
+  // The opening chars that are not closed yet
+  std::string open;
+  bool prefix = false;
+
+  for (size_t i = 0; i < region.size(); i++) {
+    switch (region[i]) {
+    case ';':
+      i = region.find('\n', i);
+      if (i == llvm::StringRef::npos) {
+        balance.unclosed = static_cast<unsigned>(open.size());
+        balance.openEnd  = true;
+        return balance;
+      }
+      break;
+
+    case '#':
+      if (region.substr(i).startswith("#|")) {
+        const auto *begin = region.data() + i;
+        const auto *end   = skipBlockComment(begin, region.end());
+
+        // An unclosed comment hides everything after it
+        if (end == nullptr) {
+          balance.unclosed = static_cast<unsigned>(open.size()) + 1;
+          return balance;
+        }
+        i += static_cast<size_t>(end - begin) - 1;
+      } else {
+        prefix = false;
+      }
+      break;
+
+    case '"':
+      prefix = false;
+      for (i++; i < region.size() && region[i] != '"'; i++) {
+        if (region[i] == '\\') {
+          i++;
+        }
+      }
+
+      if (i >= region.size()) {
+        balance.unclosed = static_cast<unsigned>(open.size()) + 1;
+        return balance;
+      }
+      break;
+
+    case '(':
+    case '[':
+    case '{':
+      prefix = false;
+      open.push_back(region[i]);
+      break;
+
+    case ')':
+    case ']':
+    case '}': {
+      prefix       = false;
+      char opening = region[i] == ')' ? '(' : region[i] == ']' ? '[' : '{';
+
+      // A mismatched closing char breaks the collection, so it counts as an
+      // extra one and the collection stays open
+      if (!open.empty() && open.back() == opening) {
+        open.pop_back();
+      } else {
+        balance.extra++;
+      }
+      break;
+    }
+
+    case '\'':
+    case '`':
+    case '~':
+    case ',':
+    case '@':
+      prefix = true;
+      break;
+
+    case ' ':
+    case '\t':
+    case '\n':
+    case '\r':
+      break;
+
+    default:
+      prefix = false;
+      break;
+    }
+  }
+
+  balance.unclosed = static_cast<unsigned>(open.size());
+  balance.openEnd  = prefix;
+  return balance;
+};
+
+// ============================================================================
+// OffsetTable
+// ============================================================================
+void OffsetTable::moveGap(size_t index) {
+  // An offset from the start and the same offset from the end of the buffer
+  // add up to the size of the buffer
+  for (; gap < index; gap++) {
+    offsets[gap] = bufferSize - offsets[gap];
+  }
+
+  for (; gap > index; gap--) {
+    offsets[gap - 1] = bufferSize - offsets[gap - 1];
+  }
+};
+
+size_t OffsetTable::lowerBound(size_t offset) const {
+  size_t low  = 0;
+  size_t high = offsets.size();
+
+  while (low < high) {
+    auto mid = low + (high - low) / 2;
+
+    if ((*this)[mid] < offset) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+
+  return low;
+};
+
+size_t OffsetTable::upperBound(size_t offset) const {
+  size_t low  = 0;
+  size_t high = offsets.size();
+
+  while (low < high) {
+    auto mid = low + (high - low) / 2;
+
+    if ((*this)[mid] <= offset) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+
+  return low;
+};
+
+void OffsetTable::reset(std::vector<size_t> newOffsets, size_t size) {
+  offsets    = std::move(newOffsets);
+  gap        = offsets.size();
+  bufferSize = size;
+};
+
+void OffsetTable::replace(size_t first, size_t last,
+                          llvm::ArrayRef<size_t> newOffsets, size_t newSize) {
+  assert(first <= last && last <= offsets.size() && "Invalid range");
+
+  // The offsets after the edit are relative to the end of the buffer from
+  // here on, so the new size doesn't affect them
+  moveGap(first);
+
+  auto pos = offsets.begin() + static_cast<ptrdiff_t>(first);
+  pos      = offsets.erase(pos, offsets.begin() + static_cast<ptrdiff_t>(last));
+
+  bufferSize = newSize;
+
+  std::vector<size_t> fromEnd;
+  fromEnd.reserve(newOffsets.size());
+  for (auto offset : newOffsets) {
+    fromEnd.push_back(newSize - offset);
+  }
+
+  offsets.insert(pos, fromEnd.begin(), fromEnd.end());
+};
+
+// ============================================================================
+// IncrementalReader
+// ============================================================================
+Location IncrementalReader::getLocation(size_t offset) const {
+  // `lineStarts` always starts with zero, so it's at least one
+  auto line = lineStarts.upperBound(offset);
+  auto col  = offset - lineStarts[line - 1] + 1;
+
+  return Location(ns, filename, nullptr, static_cast<unsigned short>(line),
+                  static_cast<unsigned short>(col));
+};
+
+Location IncrementalReader::getLocation(size_t index,
+                                        const Location &loc) const {
+  // Line zero means that the location is not set
+  if (loc.line == 0) {
+    return loc;
+  }
+
+  const auto &origin = origins[index];
+  auto begin         = ranges[2 * index];
+  auto start         = getLocation(begin);
+
+  Location result = loc;
+
+  // A form at the start of a line starts at the newline before it (look at
+  // `Reader::advanceByOne`), or at column zero if it was the first form of
+  // its region. Either way an edit might have changed that line.
+  if (begin > 0 && (loc.line < origin.line || loc.col == 0)) {
+    auto newline = getLocation(begin - 1);
+    result.line  = newline.line;
+    result.col   = newline.col;
+    return result;
+  }
+
+  result.line =
+      static_cast<unsigned short>(start.line + (loc.line - origin.line));
+
+  // The columns of the other lines don't depend on where the form starts
+  if (loc.line == origin.line) {
+    result.col =
+        static_cast<unsigned short>(start.col + (loc.col - origin.col));
+  }
+
+  return result;
+};
+
+void IncrementalReader::updateLines(size_t offset, size_t removed,
+                                    llvm::StringRef inserted) {
+  // The lines that start right after a removed newline are gone
+  auto first = lineStarts.upperBound(offset);
+  auto last  = lineStarts.upperBound(offset + removed);
+
+  std::vector<size_t> added;
+  for (size_t i = 0; i < inserted.size(); i++) {
+    if (inserted[i] == '\n') {
+      added.push_back(offset + i + 1);
+    }
+  }
+
+  lineStarts.replace(first, last, added, text.size());
+};
+
+IncrementalReader::Region IncrementalReader::readRegion(FormRange region) {
+  Reader r(llvm::StringRef(text).slice(region.begin, region.end), ns, filename,
+           getLocation(region.begin));
+  // The text changes with every edit, so nodes can't point to it
+  r.ownStrings();
+  r.recoverFromErrors();
+
+  Region result;
+  // The reader never fails in the recovery mode
+  result.forms = llvm::cantFail(r.read());
+
+  for (const auto &range : r.getFormRanges()) {
+    auto begin = range.begin + region.begin;
+    auto start = getLocation(begin);
+
+    result.ranges.push_back(begin);
+    result.ranges.push_back(range.end + region.begin);
+    result.origins.push_back({start.line, start.col});
+  }
+
+  return result;
+};
+
+void IncrementalReader::reset(llvm::StringRef newText) {
+  text = newText.str();
+
+  std::vector<size_t> starts{0};
+  for (size_t i = 0; i < text.size(); i++) {
+    if (text[i] == '\n') {
+      starts.push_back(i + 1);
+    }
+  }
+  lineStarts.reset(std::move(starts), text.size());
+
+  auto region = readRegion({0, text.size()});
+  forms       = std::move(region.forms);
+  origins     = std::move(region.origins);
+  ranges.reset(std::move(region.ranges), text.size());
+};
+
+void IncrementalReader::edit(size_t offset, size_t length,
+                             llvm::StringRef replacement) {
+  assert(offset + length <= text.size() && "The edit is out of the buffer");
+
+  auto editEnd    = offset + length;
+  auto numOfForms = forms.size();
+
+  // The forms that touch the edit have to be read again. That includes the
+  // ones that end right where the edit starts, e.g. typing at the end of a
+  // symbol. The begin and end of each form are one after another in
+  // `ranges`, so an odd index means that the offset is inside of a form.
+  size_t first = ranges.lowerBound(offset) / 2;
+  size_t last  = (ranges.upperBound(editEnd) + 1) / 2;
+
+  size_t regionBegin = first == 0 ? 0 : ranges[2 * first - 1];
+  size_t regionEnd   = last == numOfForms ? text.size() : ranges[2 * last];
+
+  text.replace(offset, length, replacement.data(), replacement.size());
+  updateLines(offset, length, replacement);
+
+  regionEnd = regionEnd - length + replacement.size();
+
+  auto getRegionBalance = [&]() {
+    return getBalance(llvm::StringRef(text).slice(regionBegin, regionEnd));
+  };
+  auto balance = getRegionBalance();
+
+  // A line comment or a quote prefix at the end of the region changes the
+  // form after it, e.g. when the edit removes a newline
+  while (balance.unclosed == 0 && balance.openEnd && last < numOfForms) {
+    last++;
+    regionEnd = last == numOfForms
+                    ? text.size()
+                    : ranges[2 * last] + replacement.size() - length;
+    balance = getRegionBalance();
+  }
+
+  bool brokenBefore = false;
+  if (!balance.isBalanced()) {
+    // The recovery of a broken form before the region depends on what comes
+    // after it, e.g. an extra closing char might complete it
+    for (size_t i = 0; i < first; i++) {
+      if (llvm::isa<ast::Error>(forms[i].get())) {
+        first        = i;
+        regionBegin  = i == 0 ? 0 : ranges[2 * i - 1];
+        brokenBefore = true;
+        break;
+      }
+    }
+  }
+
+  // An unclosed collection or string changes the meaning of everything after
+  // it and so does a broken form that we read again. An extra closing char
+  // on its own is just a form by itself.
+  if (balance.unclosed > 0 || brokenBefore) {
+    regionEnd = text.size();
+    last      = numOfForms;
+  }
+
+  auto region = readRegion({regionBegin, regionEnd});
+
+  // Splice the new forms in place of the old ones
+  auto firstForm = static_cast<ptrdiff_t>(first);
+  auto lastForm  = static_cast<ptrdiff_t>(last);
+
+  forms.erase(forms.begin() + firstForm, forms.begin() + lastForm);
+  forms.insert(forms.begin() + firstForm,
+               std::make_move_iterator(region.forms.begin()),
+               std::make_move_iterator(region.forms.end()));
+
+  origins.erase(origins.begin() + firstForm, origins.begin() + lastForm);
+  origins.insert(origins.begin() + firstForm, region.origins.begin(),
+                 region.origins.end());
+
+  ranges.replace(2 * first, 2 * last, region.ranges, text.size());
+};
+
+} // namespace serene
@@ -0,0 +1,175 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Commentary:
+ * `IncrementalReader` keeps the AST of a source buffer in sync with the
+ * edits to the buffer, e.g. the changes that an editor sends to the LSP
+ * server on every keystroke.
+ *
+ * It keeps the byte range of every top level form. On each edit, only the
+ * top level forms that overlap with the edit are read again and spliced
+ * into the AST. Nothing after the edit is touched:
+ *
+ * - The byte ranges of the forms and the start of the lines are kept in
+ *   `OffsetTable`s. The offsets after the last edit are relative to the end
+ *   of the buffer, so they don't change when the buffer grows or shrinks
+ *   before them.
+ * - The nodes keep the locations that they had when they were read. Each
+ *   form remembers where it started back then, so the current location of
+ *   any node is derived from the current start of its form on demand. Look
+ *   at `getLocation`.
+ *
+ * If the edited region has an unclosed collection or string, everything
+ * after it is read again, and if it has an extra closing char the region
+ * grows back to the first broken form before it.
+ *
+ * The reader runs in the recovery mode, so broken forms become error nodes
+ * and the rest of the buffer is still available. For broken code, the
+ * error nodes might cover a different range than a full read would, since
+ * the resync point of the reader depends on the text after the region.
+ */
+
+#ifndef INCREMENTAL_READER_H
+#define INCREMENTAL_READER_H
+
+#include "ast/ast.h"
+#include "location.h"
+#include "reader.h"
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/StringRef.h>
+
+#include <string>
+#include <vector>
+
+namespace serene {
+
+/// A sorted list of byte offsets into a buffer that is edited all the time.
+/// The offsets before the gap are the distance from the start of the buffer
+/// and the ones after the gap are the distance from the end of it. So an
+/// edit at the gap doesn't change any of them. Only the offsets between the
+/// gap and the next edit have to be converted, and that is just a few of
+/// them since the edits are usually close to each other.
+class OffsetTable {
+  std::vector<size_t> offsets;
+  size_t gap = 0;
+  /// The size of the buffer that the offsets after the gap are relative to
+  size_t bufferSize = 0;
+
+  /// Move the gap to right before the offset at \p index.
+  void moveGap(size_t index);
+
+public:
+  size_t size() const { return offsets.size(); };
+
+  /// Return the offset at \p index from the start of the buffer.
+  size_t operator[](size_t index) const {
+    return index < gap ? offsets[index] : bufferSize - offsets[index];
+  };
+
+  /// Return the index of the first offset that is not less than \p offset.
+  size_t lowerBound(size_t offset) const;
+  /// Return the index of the first offset that is greater than \p offset.
+  size_t upperBound(size_t offset) const;
+
+  /// Replace all the offsets with \p newOffsets of a buffer of the given
+  /// \p size.
+  void reset(std::vector<size_t> newOffsets, size_t size);
+
+  /// Replace the offsets in `[first, last)` with \p newOffsets after an edit
+  /// that changed the size of the buffer to \p newSize. The offsets before
+  /// \p first have to be before the edit and the ones from \p last after it.
+  void replace(size_t first, size_t last, llvm::ArrayRef<size_t> newOffsets,
+               size_t newSize);
+};
+
+class IncrementalReader {
+  llvm::StringRef ns;
+  std::optional<llvm::StringRef> filename;
+
+  /// The current content of the buffer
+  std::string text;
+
+  ast::Ast forms;
+  /// The begin and end offsets of each form in `forms`, one after another
+  OffsetTable ranges;
+
+  struct Origin {
+    unsigned short line;
+    unsigned short col;
+  };
+  /// The location of the first char of each form when it was read
+  std::vector<Origin> origins;
+
+  /// The offset of the first char of each line
+  OffsetTable lineStarts;
+
+  /// Return the location of the char at the given \p offset of `text`.
+  Location getLocation(size_t offset) const;
+
+  /// Update the `lineStarts` after replacing \p removed bytes at \p offset
+  /// with \p inserted.
+  void updateLines(size_t offset, size_t removed, llvm::StringRef inserted);
+
+  struct Region {
+    ast::Ast forms;
+    /// The begin and end offsets of the forms, one after another
+    std::vector<size_t> ranges;
+    std::vector<Origin> origins;
+  };
+
+  /// Read the given \p region of `text`.
+  Region readRegion(FormRange region);
+
+public:
+  IncrementalReader(llvm::StringRef ns, std::optional<llvm::StringRef> filename)
+      : ns(ns), filename(filename){};
+
+  /// Replace the whole buffer with \p newText and read it from scratch.
+  void reset(llvm::StringRef newText);
+
+  /// Replace the \p length bytes at \p offset of the buffer with the given
+  /// \p replacement and update the AST.
+  void edit(size_t offset, size_t length, llvm::StringRef replacement);
+
+  /// Return the current AST. Error nodes represent the broken forms. The
+  /// locations of the nodes might be stale, use `getLocation` to get their
+  /// current location.
+  const ast::Ast &getAst() const { return forms; };
+
+  size_t getNumOfForms() const { return forms.size(); };
+
+  /// Return the current byte range of the form at \p index.
+  FormRange getFormRange(size_t index) const {
+    return {ranges[2 * index], ranges[2 * index + 1]};
+  };
+
+  /// Return the current location of the given \p loc of a node of the form
+  /// at \p index.
+  Location getLocation(size_t index, const Location &loc) const;
+  LocationRange getLocation(size_t index, const LocationRange &loc) const {
+    return {getLocation(index, loc.start), getLocation(index, loc.end)};
+  };
+
+  llvm::StringRef getText() const { return text; };
+};
+
+} // namespace serene
+
+#endif
@@ -0,0 +1,146 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "jit/arith.h"
+
+#include "jit/gc.h"
+#include "types.h"
+
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Intrinsics.h>
+#include <llvm/IR/MDBuilder.h>
+#include <llvm/Support/ErrorHandling.h>
+
+namespace serene::jit {
+
+static llvm::Value *emitFloatArith(llvm::IRBuilderBase &builder, ArithOp op,
+                                   llvm::Value *a, llvm::Value *b) {
+  switch (op) {
+  case ArithOp::Add:
+    return builder.CreateFAdd(a, b);
+  case ArithOp::Sub:
+    return builder.CreateFSub(a, b);
+  case ArithOp::Mul:
+    return builder.CreateFMul(a, b);
+  }
+
+  llvm_unreachable("Unknown arithmetic operation");
+};
+
+/// Emit \p op on the tagged fixnums \p a and \p b. It returns the tagged
+/// result and whether it overflowed.
+static std::pair<llvm::Value *, llvm::Value *>
+emitFixnumArith(llvm::IRBuilderBase &builder, ArithOp op, llvm::Value *a,
+                llvm::Value *b) {
+  auto *tag = builder.getInt64(SERENE_FIXNUM_TAG);
+  llvm::Value *ret = nullptr;
+
+  switch (op) {
+  case ArithOp::Add:
+    // (2x + 1) + (2y + 1) - 1 = 2(x + y) + 1
+    ret = builder.CreateBinaryIntrinsic(llvm::Intrinsic::sadd_with_overflow,
+                                        a, builder.CreateSub(b, tag));
+    break;
+
+  case ArithOp::Sub:
+    // (2x + 1) - (2y + 1) + 1 = 2(x - y) + 1
+    ret = builder.CreateBinaryIntrinsic(llvm::Intrinsic::ssub_with_overflow,
+                                        a, builder.CreateSub(b, tag));
+    break;
+
+  case ArithOp::Mul: {
+    // (2x) * y = 2xy and the tag goes back in afterwards
+    ret = builder.CreateBinaryIntrinsic(
+        llvm::Intrinsic::smul_with_overflow, builder.CreateSub(a, tag),
+        builder.CreateAShr(b, 1));
+    auto *product = builder.CreateOr(builder.CreateExtractValue(ret, 0), tag);
+    return {product, builder.CreateExtractValue(ret, 1)};
+  }
+  }
+
+  return {builder.CreateExtractValue(ret, 0),
+          builder.CreateExtractValue(ret, 1)};
+};
+
+static const char *getSlowPathName(ArithOp op) {
+  switch (op) {
+  case ArithOp::Add:
+    return ARITH_ADD_FN;
+  case ArithOp::Sub:
+    return ARITH_SUB_FN;
+  case ArithOp::Mul:
+    return ARITH_MUL_FN;
+  }
+
+  llvm_unreachable("Unknown arithmetic operation");
+};
+
+llvm::Value *emitArith(llvm::IRBuilderBase &builder, ArithOp op,
+                       llvm::Value *a, llvm::Value *b, NumericHint hint) {
+  if (hint == NumericHint::Float) {
+    return emitFloatArith(builder, op, a, b);
+  }
+
+  auto &ctx = builder.getContext();
+  auto *i64 = builder.getInt64Ty();
+  auto *ref = a->getType();
+  auto *fn  = builder.GetInsertBlock()->getParent();
+
+  llvm::MDBuilder md(ctx);
+  auto *likely = md.createBranchWeights(2000, 1);
+
+  auto *fast = llvm::BasicBlock::Create(ctx, "arith.fast", fn);
+  auto *slow = llvm::BasicBlock::Create(ctx, "arith.slow", fn);
+  auto *done = llvm::BasicBlock::Create(ctx, "arith.done", fn);
+
+  auto *x = builder.CreatePtrToInt(a, i64);
+  auto *y = builder.CreatePtrToInt(b, i64);
+
+  if (hint == NumericHint::Fixnum) {
+    builder.CreateBr(fast);
+  } else {
+    // Both are fixnums if the low bit of both of them is set
+    auto *both = builder.CreateAnd(builder.CreateAnd(x, y),
+                                   builder.getInt64(SERENE_FIXNUM_TAG));
+    builder.CreateCondBr(builder.CreateICmpNE(both, builder.getInt64(0)),
+                         fast, slow, likely);
+  }
+
+  builder.SetInsertPoint(fast);
+  auto [result, overflow] = emitFixnumArith(builder, op, x, y);
+  // The statepoint rewrite treats an `inttoptr` as a base pointer
+  auto *fastResult = builder.CreateIntToPtr(result, ref);
+  auto *fastEnd    = builder.GetInsertBlock();
+  builder.CreateCondBr(overflow, slow, done,
+                       md.createBranchWeights(1, 2000));
+
+  // The runtime boxes the results that don't fit in a fixnum
+  builder.SetInsertPoint(slow);
+  auto *type       = llvm::FunctionType::get(ref, {ref, ref}, false);
+  auto *slowResult = builder.CreateCall(
+      getLeafFunction(builder, getSlowPathName(op), type), {a, b});
+  builder.CreateBr(done);
+
+  builder.SetInsertPoint(done);
+  auto *ret = builder.CreatePHI(ref, 2, "arith");
+  ret->addIncoming(fastResult, fastEnd);
+  ret->addIncoming(slowResult, slow);
+  return ret;
+};
+
+} // namespace serene::jit
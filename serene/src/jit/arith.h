@@ -0,0 +1,75 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Commentary:
+ * The arithmetic of the JIT'd code. The values are `ptr addrspace(1)`
+ * words (look at `jit/gc.h`) and a fixnum is just a tagged int in such a
+ * word. The fixnum arithmetic works on the tagged words directly (look at
+ * `addFixnums` in `types.h`), so there's nothing to box or unbox on the
+ * fast path. `emitArith` emits:
+ *
+ * - A tag check of the operands, unless the analyzer proved that both of
+ *   them are fixnums.
+ * - The operation on the tagged words via the `llvm.s*.with.overflow`
+ *   intrinsics.
+ * - A call to the generic arithmetic of the runtime (`runtime/number.h`)
+ *   if an operand is not a fixnum or the result doesn't fit in one. Both
+ *   branches are weighted, so the fast path is the fall through.
+ *
+ * Floats that the analyzer proves are kept unboxed as `double`s and they
+ * only need the plain float instructions.
+ */
+
+#ifndef JIT_ARITH_H
+#define JIT_ARITH_H
+
+namespace llvm {
+class IRBuilderBase;
+class Value;
+} // namespace llvm
+
+#define ARITH_ADD_FN "__serene_add"
+#define ARITH_SUB_FN "__serene_sub"
+#define ARITH_MUL_FN "__serene_mul"
+
+namespace serene::jit {
+
+enum class ArithOp { Add, Sub, Mul };
+
+/// What the analyzer knows about the operands of an arithmetic operation
+enum class NumericHint {
+  /// Any values, e.g. fixnums, boxed ints or not even numbers
+  Unknown,
+  /// Both operands are fixnums
+  Fixnum,
+  /// Both operands are unboxed `double`s
+  Float,
+};
+
+/// Emit `a op b` and return the result. For the `Float` hint, \p a and
+/// \p b are `double`s and so is the result. Otherwise they're values and
+/// the result is a value that the runtime might have boxed. The builder
+/// ends up at the end of a new block, except for the floats.
+llvm::Value *emitArith(llvm::IRBuilderBase &builder, ArithOp op,
+                       llvm::Value *a, llvm::Value *b,
+                       NumericHint hint = NumericHint::Unknown);
+
+} // namespace serene::jit
+
+#endif
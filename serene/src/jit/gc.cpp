@@ -0,0 +1,192 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "jit/gc.h"
+
+#include "runtime/gc.h"
+
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/MDBuilder.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/PassManager.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/MathExtras.h>
+#include <llvm/Transforms/Scalar/RewriteStatepointsForGC.h>
+
+#include <algorithm>
+
+namespace serene::jit {
+
+uint8_t *GCMemoryManager::allocateDataSection(uintptr_t size,
+                                              unsigned alignment,
+                                              unsigned sectionID,
+                                              llvm::StringRef sectionName,
+                                              bool isReadOnly) {
+  auto *ret = llvm::SectionMemoryManager::allocateDataSection(
+      size, alignment, sectionID, sectionName, isReadOnly);
+
+  // ELF and MachO names
+  if (sectionName == ".llvm_stackmaps" || sectionName == "__llvm_stackmaps") {
+    stackMaps.push_back(llvm::ArrayRef<uint8_t>(ret, size));
+  }
+
+  return ret;
+};
+
+bool GCMemoryManager::finalizeMemory(std::string *errMsg) {
+  // The sections are relocated by now, so the function addresses in the
+  // stack maps are the final ones
+  for (auto section : stackMaps) {
+    runtime::registerStackMaps(section);
+  }
+
+  stackMaps.clear();
+  return llvm::SectionMemoryManager::finalizeMemory(errMsg);
+};
+
+void rewriteStatepoints(llvm::Module &m) {
+  bool hasGC = false;
+
+  for (auto &f : m) {
+    if (f.hasGC()) {
+      // The collector walks the JIT'd frames via their frame pointers
+      f.addFnAttr("frame-pointer", "all");
+      hasGC = true;
+    }
+  }
+
+  if (!hasGC) {
+    return;
+  }
+
+  llvm::LoopAnalysisManager lam;
+  llvm::FunctionAnalysisManager fam;
+  llvm::CGSCCAnalysisManager cgam;
+  llvm::ModuleAnalysisManager mam;
+
+  llvm::PassBuilder pb;
+  pb.registerModuleAnalyses(mam);
+  pb.registerCGSCCAnalyses(cgam);
+  pb.registerFunctionAnalyses(fam);
+  pb.registerLoopAnalyses(lam);
+  pb.crossRegisterProxies(lam, fam, cgam, mam);
+
+  llvm::ModulePassManager mpm;
+  mpm.addPass(llvm::RewriteStatepointsForGC());
+  mpm.run(m, mam);
+};
+
+llvm::FunctionCallee getLeafFunction(llvm::IRBuilderBase &builder,
+                                     llvm::StringRef name,
+                                     llvm::FunctionType *type) {
+  auto *m = builder.GetInsertBlock()->getModule();
+  auto fn = m->getOrInsertFunction(name, type);
+
+  if (auto *f = llvm::dyn_cast<llvm::Function>(fn.getCallee())) {
+    f->addFnAttr("gc-leaf-function");
+    f->addFnAttr(llvm::Attribute::NoUnwind);
+  }
+
+  return fn;
+};
+
+llvm::Value *emitGetTLAB(llvm::IRBuilderBase &builder) {
+  auto *type = llvm::FunctionType::get(
+      llvm::PointerType::get(builder.getContext(), 0), false);
+
+  return builder.CreateCall(getLeafFunction(builder, GC_GET_TLAB_FN, type), {},
+                            "tlab");
+};
+
+llvm::Value *emitAllocation(llvm::IRBuilderBase &builder, llvm::Value *tlab,
+                            uint64_t size, runtime::Layout layout) {
+  auto &ctx     = builder.getContext();
+  auto *i64     = builder.getInt64Ty();
+  auto *ptr     = llvm::PointerType::get(ctx, 0);
+  auto *ref     = llvm::PointerType::get(ctx, GC_ADDRESS_SPACE);
+  auto layoutId = static_cast<uint8_t>(layout);
+
+  // The same size as the runtime `allocate`
+  uint64_t total =
+      std::max(llvm::alignTo(size + SERENE_GC_HEADER_SIZE, sizeof(uint64_t)),
+               2 * sizeof(uint64_t));
+
+  auto *slowType =
+      llvm::FunctionType::get(ref, {i64, builder.getInt8Ty()}, false);
+  auto slowFn = getLeafFunction(builder, GC_ALLOCATE_FN, slowType);
+
+  if (total > SERENE_GC_LARGE_OBJECT_SIZE) {
+    return builder.CreateCall(
+        slowFn, {builder.getInt64(total), builder.getInt8(layoutId)});
+  }
+
+  auto *fn   = builder.GetInsertBlock()->getParent();
+  auto *fast = llvm::BasicBlock::Create(ctx, "alloc.fast", fn);
+  auto *slow = llvm::BasicBlock::Create(ctx, "alloc.slow", fn);
+  auto *done = llvm::BasicBlock::Create(ctx, "alloc.done", fn);
+
+  auto *cursorPtr = builder.CreateConstInBoundsGEP1_64(
+      builder.getInt8Ty(), tlab, SERENE_TLAB_CURSOR_OFFSET);
+  auto *limitPtr = builder.CreateConstInBoundsGEP1_64(
+      builder.getInt8Ty(), tlab, SERENE_TLAB_LIMIT_OFFSET);
+
+  auto *cursor    = builder.CreateLoad(i64, cursorPtr, "tlab.cursor");
+  auto *limit     = builder.CreateLoad(i64, limitPtr, "tlab.limit");
+  auto *newCursor = builder.CreateAdd(cursor, builder.getInt64(total));
+
+  // A reset buffer has a null cursor and limit, so it takes the slow path
+  llvm::MDBuilder md(ctx);
+  builder.CreateCondBr(builder.CreateICmpULE(newCursor, limit), fast, slow,
+                       md.createBranchWeights(2000, 1));
+
+  // The fast path: write the header and bump the cursor
+  builder.SetInsertPoint(fast);
+  auto *header     = builder.CreateIntToPtr(cursor, ptr);
+  auto headerField = [&](unsigned offset) {
+    return builder.CreateConstInBoundsGEP1_64(builder.getInt8Ty(), header,
+                                              offset);
+  };
+
+  builder.CreateStore(builder.getInt32(static_cast<uint32_t>(total)),
+                      headerField(SERENE_GC_HEADER_SIZE_OFFSET));
+  builder.CreateStore(builder.getInt8(layoutId),
+                      headerField(SERENE_GC_HEADER_LAYOUT_OFFSET));
+  builder.CreateStore(builder.getInt8(0),
+                      headerField(SERENE_GC_HEADER_FLAGS_OFFSET));
+  builder.CreateStore(builder.getInt16(0),
+                      headerField(SERENE_GC_HEADER_FLAGS_OFFSET + 1));
+  builder.CreateStore(newCursor, cursorPtr);
+
+  // The statepoint rewrite treats an `inttoptr` as a base pointer
+  auto *fastObject = builder.CreateIntToPtr(
+      builder.CreateAdd(cursor, builder.getInt64(SERENE_GC_HEADER_SIZE)), ref);
+  builder.CreateBr(done);
+
+  builder.SetInsertPoint(slow);
+  auto *slowObject = builder.CreateCall(
+      slowFn, {builder.getInt64(total), builder.getInt8(layoutId)});
+  builder.CreateBr(done);
+
+  builder.SetInsertPoint(done);
+  auto *object = builder.CreatePHI(ref, 2, "object");
+  object->addIncoming(fastObject, fast);
+  object->addIncoming(slowObject, slow);
+  return object;
+};
+
+} // namespace serene::jit
@@ -0,0 +1,108 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Commentary:
+ * The JIT side of the GC (look at `runtime/gc.h`).
+ *
+ * - `rewriteStatepoints` turns the calls of the functions that use the GC
+ *   into statepoints, so the stack maps have the live references at each
+ *   call. Those functions have to use the `GC_STRATEGY_NAME` strategy and
+ *   keep the values as `ptr addrspace(1)`.
+ * - `GCMemoryManager` finds the `.llvm_stackmaps` section of each JIT'd
+ *   object and registers it with the collector once it's relocated.
+ * - `emitAllocation` bumps the allocation buffer of the thread inline and
+ *   only calls the runtime when the buffer is full.
+ */
+
+#ifndef JIT_GC_H
+#define JIT_GC_H
+
+#include "runtime/heap.h"
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/ExecutionEngine/SectionMemoryManager.h>
+
+#include <cstdint>
+#include <string>
+
+namespace llvm {
+class FunctionCallee;
+class FunctionType;
+class IRBuilderBase;
+class Module;
+class Value;
+} // namespace llvm
+
+// LLVM only rewrites the functions of its own strategies. This one treats
+// the pointers in the address space 1 as the GC references.
+#define GC_STRATEGY_NAME "statepoint-example"
+#define GC_ADDRESS_SPACE 1
+#define GC_SAFEPOINT_FN  "__serene_gc_safepoint"
+#define GC_GET_TLAB_FN   "__serene_gc_get_tlab"
+#define GC_ALLOCATE_FN   "__serene_gc_allocate"
+
+namespace serene::jit {
+
+class GCMemoryManager : public llvm::SectionMemoryManager {
+  /// The stack maps of the object that is being loaded
+  llvm::SmallVector<llvm::ArrayRef<uint8_t>, 1> stackMaps;
+
+public:
+  uint8_t *allocateDataSection(uintptr_t size, unsigned alignment,
+                               unsigned sectionID, llvm::StringRef sectionName,
+                               bool isReadOnly) override;
+
+  bool finalizeMemory(std::string *errMsg = nullptr) override;
+};
+
+/// Rewrite the calls in the GC'd functions of the module \p m to
+/// statepoints. It has to be the last transformation on the IR.
+void rewriteStatepoints(llvm::Module &m);
+
+/// Declare the runtime function \p name in the module of the \p builder.
+/// The function must never collect, so its calls don't have to be
+/// statepoints.
+llvm::FunctionCallee getLeafFunction(llvm::IRBuilderBase &builder,
+                                     llvm::StringRef name,
+                                     llvm::FunctionType *type);
+
+/// Emit a call to get the allocation buffer of the current thread. Call it
+/// once in the entry block of a function and pass the result to all the
+/// `emitAllocation`s of that function.
+llvm::Value *emitGetTLAB(llvm::IRBuilderBase &builder);
+
+/// Emit the allocation of a GC object of \p size bytes with the given
+/// \p layout and return it as a `ptr addrspace(1)`, e.g.
+/// \code
+/// auto *tlab = emitGetTLAB(builder);
+/// auto *pair = emitAllocation(builder, tlab, sizeof(runtime::Pair),
+///                             runtime::Layout::Pair);
+/// \endcode
+///
+/// It bumps the \p tlab inline and falls back to the runtime once the
+/// buffer is full. The builder ends up at the end of a new block. Neither
+/// path collects, so the allocation is not a statepoint.
+llvm::Value *emitAllocation(llvm::IRBuilderBase &builder, llvm::Value *tlab,
+                            uint64_t size, runtime::Layout layout);
+
+} // namespace serene::jit
+
+#endif
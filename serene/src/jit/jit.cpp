@@ -18,6 +18,7 @@
 
 #include "jit/jit.h"
 
+#include "jit/gc.h"
 #include "options.h" // for Options
 
 #include <__type_traits/remove_reference.h> // for remov...
@@ -212,7 +213,8 @@ MaybeJIT JIT::make(llvm::orc::JITTargetMachineBuilder &&jtmb,
 
     auto objectLayer =
         std::make_unique<llvm::orc::RTDyldObjectLinkingLayer>(session, []() {
-          return std::make_unique<llvm::SectionMemoryManager>();
+          // It registers the stack maps of the objects with the GC
+          return std::make_unique<GCMemoryManager>();
         });
 
     // Register JIT event listeners if they are enabled.
@@ -262,6 +264,16 @@ MaybeJIT JIT::make(llvm::orc::JITTargetMachineBuilder &&jtmb,
     });
   };
 
+  // Turn the calls of the GC'd functions into statepoints right before
+  // the compilation
+  auto gcTransform = [](llvm::orc::ThreadSafeModule tsm,
+                        const llvm::orc::MaterializationResponsibility &r)
+      -> llvm::Expected<llvm::orc::ThreadSafeModule> {
+    (void)r;
+    tsm.withModuleDo([](llvm::Module &m) { rewriteStatepoints(m); });
+    return tsm;
+  };
+
   if (jitEngine->options->JITLazy) {
     // Setup a LLLazyJIT instance to the times that latency is important
     // for example in a REPL. This way
@@ -271,6 +283,7 @@ MaybeJIT JIT::make(llvm::orc::JITTargetMachineBuilder &&jtmb,
                      .setObjectLinkingLayerCreator(objectLinkingLayerCreator)
                      .create());
     jit->getIRCompileLayer().setNotifyCompiled(compileNotifier);
+    jit->getIRTransformLayer().setTransform(gcTransform);
     jitEngine->engine = std::move(jit);
 
   } else {
@@ -283,6 +296,7 @@ MaybeJIT JIT::make(llvm::orc::JITTargetMachineBuilder &&jtmb,
                      .setObjectLinkingLayerCreator(objectLinkingLayerCreator)
                      .create());
     jit->getIRCompileLayer().setNotifyCompiled(compileNotifier);
+    jit->getIRTransformLayer().setTransform(gcTransform);
     jitEngine->engine = std::move(jit);
   }
 
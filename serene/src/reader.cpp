@@ -35,14 +35,19 @@
 #include <llvm/Support/FormatVariadic.h>
 #include <llvm/Support/MemoryBuffer.h>
 #include <llvm/Support/SMLoc.h>
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Support/Threading.h>
 #include <mlir/IR/Diagnostics.h>
 #include <mlir/IR/Location.h>
 #include <mlir/IR/MLIRContext.h>
 #include <mlir/Support/LogicalResult.h>
 
+#include <algorithm>
 #include <assert.h>
 #include <cctype>
+#include <cstring>
 #include <fstream>
+#include <iterator>
 #include <memory>
 #include <string>
 
@@ -101,14 +106,17 @@ void decLocation(Location &loc, const char *c) {
 
 Reader::Reader(llvm::StringRef buffer, llvm::StringRef ns,
                std::optional<llvm::StringRef> filename)
-    : ns(ns), filename(filename), buf(buffer),
-      currentLocation(Location(ns, filename)) {
+    : Reader(buffer, ns, filename, Location(ns, filename, nullptr, 1, 1)){};
+
+Reader::Reader(llvm::StringRef buffer, llvm::StringRef ns,
+               std::optional<llvm::StringRef> filename, const Location &start)
+    : ns(ns), filename(filename), buf(buffer), currentLocation(start) {
 
   READER_LOG("Setting the first char of the buffer");
-  currentChar          = buf.begin() - 1;
-  currentPos           = 1;
-  currentLocation.line = 1;
-  currentLocation.col  = 1;
+  // We start one char before the buffer and `advance` will move us to the
+  // first char, so the location has to be one column behind as well.
+  currentChar = buf.begin() - 1;
+  currentLocation.col--;
 };
 
 Reader::Reader(llvm::MemoryBufferRef buffer, llvm::StringRef ns,
@@ -119,9 +127,12 @@ Reader::~Reader() { READER_LOG("Destroying the reader"); }
 
 void Reader::advanceByOne() {
   currentChar++;
-  currentPos++;
   currentLocation.col++;
 
+  if (currentChar >= buf.end()) {
+    return;
+  }
+
   if (*currentChar == '\n') {
     READER_LOG("Detected end of line");
 
@@ -142,39 +153,192 @@ void Reader::advanceByOne() {
   READER_LOG("Moving to Char: " << *currentChar << " at location: "
                                 << currentLocation.toString());
 };
-void Reader::advance(bool skipWhitespace) {
-  if (skipWhitespace) {
-    for (;;) {
-      const auto *next = currentChar + 1;
+void Reader::advanceTo(const char *c) {
+  assert(c > currentChar && c < buf.end() && "Can't move to the given char");
+
+  // The line of a char is the number of newlines before it and its column
+  // is the distance to the last newline before it. `currentChar` might
+  // be right before the buffer.
+  const auto *from = std::max(currentChar, buf.begin());
+  auto newlines    = std::count(from, c, '\n');
+
+  if (newlines == 0) {
+    currentLocation.col += c - currentChar;
+  } else {
+    const auto *lastNewline =
+        std::find(std::make_reverse_iterator(c),
+                  std::make_reverse_iterator(from), '\n')
+            .base() -
+        1;
+
+    currentLocation.line += newlines;
+    currentLocation.col = c - lastNewline;
+  }
+
+  currentChar = c;
+  readEOL     = *c == '\n';
+
+  READER_LOG("Moving to Char: " << *currentChar << " at location: "
+                                << currentLocation.toString());
+};
+
+/// The prefix of the comments that document the form after them
+constexpr static llvm::StringLiteral DOC_COMMENT_PREFIX = ";;;";
+
+/// Return a boolean indicating whether a block comment starts at \p c
+static bool isBlockCommentStart(const char *c, const char *end) {
+  return end - c >= 2 && c[0] == '#' && c[1] == '|';
+};
+
+const char *skipBlockComment(const char *c, const char *end) {
+  unsigned depth = 1;
+  // Skip the `#|`
+  c += 2;
+
+  while (c < end) {
+    // Both ends of a block comment have a `|`, so jump to the next one
+    const auto *bar = static_cast<const char *>(
+        std::memchr(c, '|', static_cast<size_t>(end - c)));
+
+    if (bar == nullptr) {
+      break;
+    }
+
+    // The `#` of a nested `#|` has to be after what we already consumed,
+    // e.g. the `#` of `|#|` belongs to the `|#`
+    if (bar > c && bar[-1] == '#') {
+      depth++;
+      c = bar + 1;
+      continue;
+    }
 
-      if (isspace(*next) == 0) {
-        return;
+    if (end - bar >= 2 && bar[1] == '#') {
+      c = bar + 2;
+      if (--depth == 0) {
+        return c;
       }
+      continue;
+    }
 
-      advanceByOne();
+    c = bar + 1;
+  }
+
+  return nullptr;
+};
+
+const char *Reader::skipTrivia(const char *c) const {
+  const auto *end = buf.end();
+
+  for (;;) {
+    while (c < end && isspace(*c) != 0) {
+      c++;
     }
-  } else {
+
+    if (isBlockCommentStart(c, end)) {
+      // An unterminated comment runs to the end, just like a line comment
+      // without a newline
+      const auto *next = skipBlockComment(c, end);
+      c                = next == nullptr ? end : next;
+      continue;
+    }
+
+    if (c >= end || *c != ';') {
+      return c;
+    }
+
+    // Jump to the end of the line comment in one go
+    const auto *newline = static_cast<const char *>(
+        std::memchr(c, '\n', static_cast<size_t>(end - c)));
+
+    c = newline == nullptr ? end : newline + 1;
+  }
+};
+
+void Reader::advance(bool skipWhitespace) {
+  if (!skipWhitespace) {
     advanceByOne();
+    return;
+  }
+
+  const auto *next = skipTrivia(currentChar + 1);
+
+  if (next - 1 <= currentChar) {
+    return;
   }
+
+  if (keepDocs) {
+    // Collect the consecutive doc comment lines right before `next`
+    const auto *docStart = next;
+    const auto *docEnd   = next;
+
+    for (const auto *c = currentChar + 1; c < next;) {
+      if (isspace(*c) != 0) {
+        c++;
+        continue;
+      }
+
+      // Anything other than whitespace before `next` is a comment. Only
+      // the line comments document a form.
+      if (isBlockCommentStart(c, next)) {
+        const auto *commentEnd = skipBlockComment(c, next);
+
+        c        = commentEnd == nullptr ? next : commentEnd;
+        docStart = docEnd = next;
+        continue;
+      }
+
+      const auto *eol = std::find(c, next, '\n');
+
+      if (llvm::StringRef(c, static_cast<size_t>(eol - c))
+              .startswith(DOC_COMMENT_PREFIX)) {
+        docStart = docEnd == next ? c : docStart;
+        docEnd   = eol;
+      } else {
+        docStart = docEnd = next;
+      }
+
+      c = eol;
+    }
+
+    if (docEnd != next) {
+      pendingDoc =
+          llvm::StringRef(docStart, static_cast<size_t>(docEnd - docStart));
+      pendingDocTarget = next;
+    }
+  }
+
+  advanceTo(next - 1);
 };
 
+/// The buffer that we read from is not necessarily null terminated (e.g. it
+/// might be a slice of a bigger buffer). So instead of reading past the end
+/// of the buffer, `nextChar` returns a pointer to this null char which
+/// `isEndOfBuffer` treats as the end of the buffer.
+static const char endOfBuffer = '\0';
+
 const char *Reader::nextChar(bool skipWhitespace, unsigned count) {
   if (!skipWhitespace) {
-    READER_LOG("Next char: " << *(currentChar + count));
-    return currentChar + count;
+    const auto *c = currentChar + count;
+    if (c >= buf.end()) {
+      return &endOfBuffer;
+    }
+
+    READER_LOG("Next char: " << *c);
+    return c;
   }
 
-  const auto *c = currentChar + 1;
-  while (isspace(*c) != 0) {
-    c++;
-  };
+  const auto *c = skipTrivia(currentChar + 1);
+
+  if (c >= buf.end()) {
+    return &endOfBuffer;
+  }
 
   READER_LOG("Next char: " << *c);
   return c;
 };
 
 bool Reader::isEndOfBuffer(const char *c) {
-  return *c == '\0' || currentPos > buf.size() ||
+  return c == &endOfBuffer || *c == '\0' ||
          (static_cast<const int>(*c) == EOF);
 };
 
@@ -312,6 +476,95 @@ ast::MaybeNode Reader::readSymbol() {
   return ast::makeSuccessfulNode<ast::Symbol>(loc, sym, this->ns);
 };
 
+/// Reads a string literal. Strings without escape sequences point directly
+/// to the buffer (unless `ownStrings` is called) and the rest own their
+/// unescaped content.
+ast::MaybeNode Reader::readString() {
+  READER_LOG("Reading a string...");
+
+  const auto *c = nextChar();
+  advance();
+  LocationRange loc(getCurrentLocation());
+
+  assert(*c == '"');
+
+  const auto *begin = c + 1;
+  const auto *end   = buf.end();
+  const auto *quote = begin;
+
+  // `memchr` is vectorized by the libc, so we jump from one quote to the
+  // next one instead of reading one char at a time.
+  for (;;) {
+    quote = static_cast<const char *>(
+        std::memchr(quote, '"', static_cast<size_t>(end - quote)));
+
+    if (quote == nullptr) {
+      if (end - 1 > currentChar) {
+        advanceTo(end - 1);
+      }
+      loc.end = getCurrentLocation();
+      return errors::make(errors::Type::EOFWhileScaningAString, loc);
+    }
+
+    // The quote is escaped if there are an odd number of `\` before it
+    size_t backslashes = 0;
+    for (const auto *p = quote - 1; p >= begin && *p == '\\'; p--) {
+      backslashes++;
+    }
+
+    if (backslashes % 2 == 0) {
+      break;
+    }
+    quote++;
+  }
+
+  llvm::StringRef content(begin, static_cast<size_t>(quote - begin));
+
+  if (content.find('\\') == llvm::StringRef::npos) {
+    advanceTo(quote);
+    loc.end = getCurrentLocation();
+    return ast::make<ast::String>(loc, content, borrowStrings);
+  }
+
+  scratch.clear();
+
+  for (const auto *p = begin; p < quote; p++) {
+    if (*p != '\\') {
+      scratch += *p;
+      continue;
+    }
+
+    p++;
+
+    switch (*p) {
+    case 'n':
+      scratch += '\n';
+      break;
+    case 't':
+      scratch += '\t';
+      break;
+    case 'r':
+      scratch += '\r';
+      break;
+    case '0':
+      scratch += '\0';
+      break;
+    case '\\':
+    case '"':
+      scratch += *p;
+      break;
+    default:
+      advanceTo(p);
+      return errors::make(errors::Type::InvalidEscapeSequence,
+                          LocationRange(getCurrentLocation()));
+    }
+  }
+
+  advanceTo(quote);
+  loc.end = getCurrentLocation();
+  return ast::make<ast::String>(loc, scratch);
+};
+
 /// Reads a list recursively
 ast::MaybeNode Reader::readList() {
   READER_LOG("Reading a list...");
@@ -360,6 +613,154 @@ ast::MaybeNode Reader::readList() {
   return list;
 };
 
+llvm::Expected<size_t> Reader::readElements(LocationRange &loc, char close,
+                                            errors::Type eofError) {
+  auto base = elementStack.size();
+
+  for (;;) {
+    const auto *ch = nextChar(true);
+
+    if (isEndOfBuffer(ch)) {
+      advance(true);
+      advance();
+      loc.end = getCurrentLocation();
+      elementStack.erase(elementStack.begin() + static_cast<ptrdiff_t>(base),
+                         elementStack.end());
+      return errors::make(eofError, loc);
+    }
+
+    if (*ch == close) {
+      advance(true);
+      advance();
+      loc.end = getCurrentLocation();
+      return elementStack.size() - base;
+    }
+
+    advance(true);
+    auto expr = readExpr();
+    if (!expr) {
+      elementStack.erase(elementStack.begin() + static_cast<ptrdiff_t>(base),
+                         elementStack.end());
+      return expr.takeError();
+    }
+
+    elementStack.push_back(std::move(*expr));
+  }
+};
+
+void Reader::popElements(ast::Collection &coll, size_t count) {
+  auto first = elementStack.end() - static_cast<ptrdiff_t>(count);
+
+  coll.elements.insert(coll.elements.end(), std::make_move_iterator(first),
+                       std::make_move_iterator(elementStack.end()));
+  elementStack.erase(first, elementStack.end());
+};
+
+/// Reads a vector literal like `[1 2 3]`
+ast::MaybeNode Reader::readVector() {
+  READER_LOG("Reading a vector...");
+
+  const auto *c = nextChar();
+  advance();
+  LocationRange loc(getCurrentLocation());
+
+  assert(*c == '[');
+
+  auto count = readElements(loc, ']', errors::Type::EOFWhileScaningAVector);
+  if (!count) {
+    return count.takeError();
+  }
+
+  auto vec = ast::makeAndCast<ast::Vector>(loc, *count);
+  popElements(*vec, *count);
+  return vec;
+};
+
+/// Reads a map literal like `{:a 1 :b 2}`
+ast::MaybeNode Reader::readMap() {
+  READER_LOG("Reading a map...");
+
+  const auto *c = nextChar();
+  advance();
+  LocationRange loc(getCurrentLocation());
+
+  assert(*c == '{');
+
+  auto count = readElements(loc, '}', errors::Type::EOFWhileScaningAMap);
+  if (!count) {
+    return count.takeError();
+  }
+
+  auto map = ast::makeAndCast<ast::Map>(loc, *count);
+  popElements(*map, *count);
+
+  if (map->elements.size() % 2 != 0) {
+    return errors::make(errors::Type::OddNumberOfFormsInMap, map->location);
+  }
+
+  return map;
+};
+
+ast::MaybeNode Reader::readMacroForm(llvm::StringRef name,
+                                     unsigned prefixLength) {
+  READER_LOG("Reading a reader macro: " << name);
+
+  for (unsigned i = 0; i < prefixLength; i++) {
+    advance();
+  }
+
+  LocationRange loc(getCurrentLocation());
+  // The head symbol is the prefix itself, e.g. `~@`
+  loc.start.col -= prefixLength - 1;
+
+  auto list = ast::makeAndCast<ast::List>(loc);
+  auto head = ast::make<ast::Symbol>(loc, name, ns);
+  list->append(head);
+
+  auto form = readExpr();
+  if (!form) {
+    return form;
+  }
+
+  if (*form == ast::EmptyNode) {
+    return errors::make(errors::Type::EOFAfterReaderMacro, loc);
+  }
+
+  list->location.end = (*form)->location.end;
+  list->append(*form);
+  return list;
+};
+
+ast::MaybeNode Reader::readQuote() { return readMacroForm("quote", 1); };
+
+ast::MaybeNode Reader::readQuasiquote() {
+  return readMacroForm("quasiquote", 1);
+};
+
+/// Reads `~form`, `~@form` and their Common Lisp flavors `,form`, `,@form`
+ast::MaybeNode Reader::readUnquote() {
+  if (*nextChar(false, 2) == '@') {
+    return readMacroForm("unquote-splicing", 2);
+  }
+  return readMacroForm("unquote", 1);
+};
+
+const std::array<Reader::ReaderFn, 256> Reader::dispatchTable = [] {
+  std::array<ReaderFn, 256> table{};
+  table.fill(&Reader::readSymbol);
+
+  table['(']  = &Reader::readList;
+  table['[']  = &Reader::readVector;
+  table['{']  = &Reader::readMap;
+  table['"']  = &Reader::readString;
+  table['\''] = &Reader::readQuote;
+  table['`']  = &Reader::readQuasiquote;
+  table['~']  = &Reader::readUnquote;
+  table[',']  = &Reader::readUnquote;
+
+  return table;
+}();
+
 /// Reads an expression by dispatching to the proper reader function.
 ast::MaybeNode Reader::readExpr() {
   const auto *c = nextChar(true);
@@ -370,16 +771,21 @@ ast::MaybeNode Reader::readExpr() {
     return ast::EmptyNode;
   }
 
-  switch (*c) {
-  case '(': {
-    advance(true);
-    return readList();
+  advance(true);
+
+  // Only the doc comment right before this form belongs to it
+  llvm::StringRef doc;
+  if (keepDocs && pendingDocTarget == c) {
+    doc = pendingDoc;
   }
 
-  default:
-    advance(true);
-    return readSymbol();
+  auto node = (this->*dispatchTable[static_cast<unsigned char>(*c)])();
+
+  if (!doc.empty() && node && *node) {
+    docs[node->get()] = doc;
   }
+
+  return node;
 };
 
 /// Reads all the expressions in the reader's buffer as an AST.
@@ -396,6 +802,11 @@ ast::MaybeAst Reader::read() {
 
     advance(true);
 
+    // In recovery mode, we need to get back here if the form is broken
+    const auto *checkpoint = currentChar;
+    auto checkpointLoc     = currentLocation;
+    auto checkpointEOL     = readEOL;
+
     auto tmp = readExpr();
 
     if (tmp) {
@@ -404,15 +815,554 @@ ast::MaybeAst Reader::read() {
       }
 
       this->ast.push_back(std::move(*tmp));
+      formRanges.push_back({static_cast<size_t>(checkpoint + 1 - buf.begin()),
+                            static_cast<size_t>(currentChar + 1 - buf.begin())});
 
     } else {
-      return tmp.takeError();
+      if (!recover) {
+        return tmp.takeError();
+      }
+
+      // Go back to the start of the form and skip it entirely
+      const auto *resume = findResyncPoint(checkpoint + 1);
+      currentChar        = checkpoint;
+      currentLocation    = checkpointLoc;
+      readEOL            = checkpointEOL;
+
+      advanceByOne();
+      auto formLoc = currentLocation;
+
+      formRanges.push_back({static_cast<size_t>(checkpoint + 1 - buf.begin()),
+                            static_cast<size_t>(resume - buf.begin())});
+
+      if (resume - 1 > currentChar) {
+        advanceTo(resume - 1);
+      }
+
+      auto node = makeErrorNode(tmp.takeError(), formLoc);
+
+      // If the form is not balanced, the reader might have failed way after
+      // the point that we continue from. So we keep the error location in
+      // the range that we skipped.
+      auto isAfterResume = [&](const Location &loc) {
+        return std::make_pair(loc.line, loc.col) >
+               std::make_pair(currentLocation.line, currentLocation.col);
+      };
+
+      if (isAfterResume(node->location.start)) {
+        node->location.start = formLoc;
+      }
+
+      if (isAfterResume(node->location.end)) {
+        node->location.end = currentLocation;
+      }
+
+      errorNodes.push_back(node.get());
+      this->ast.push_back(std::move(node));
     }
   }
 
   return std::move(this->ast);
 };
 
+std::unique_ptr<ast::Error> Reader::makeErrorNode(llvm::Error err,
+                                                  const Location &formStart) {
+  std::string msg;
+  LocationRange loc(formStart);
+
+  llvm::handleAllErrors(
+      std::move(err),
+      [&](const errors::Error &e) {
+        // `LocationRange` has no copy assignment
+        loc.start = e.location.start;
+        loc.end   = e.location.end;
+        msg = e.msg.empty() ? errors::errorMessages[static_cast<int>(e.type)]
+                            : e.msg;
+      },
+      [&](const llvm::ErrorInfoBase &e) { msg = e.message(); });
+
+  return ast::makeAndCast<ast::Error>(loc, nullptr, msg);
+};
+
+const char *Reader::findResyncPoint(const char *formStart) const {
+  const auto *end = buf.end();
+  const auto *c   = formStart;
+  unsigned depth  = 0;
+
+  while (c < end) {
+    switch (*c) {
+    case ';':
+      c = skipTrivia(c);
+      break;
+
+    case '#':
+      if (isBlockCommentStart(c, end)) {
+        const auto *next = skipBlockComment(c, end);
+        c                = next == nullptr ? end : next;
+        break;
+      }
+
+      c++;
+      if (depth == 0) {
+        return c;
+      }
+      break;
+
+    case '"':
+      for (c++; c < end && *c != '"'; c++) {
+        if (*c == '\\') {
+          c++;
+        }
+      }
+      c = std::min(c + 1, end);
+
+      if (depth == 0) {
+        return c;
+      }
+      break;
+
+    case '(':
+    case '[':
+    case '{':
+      depth++;
+      c++;
+      break;
+
+    case ')':
+    case ']':
+    case '}':
+      c++;
+      // A stray closing char at the top level is a form by itself
+      if (depth <= 1) {
+        return c;
+      }
+      depth--;
+      break;
+
+    case '\'':
+    case '`':
+    case '~':
+    case ',':
+    case '@':
+      c++;
+      break;
+
+    default:
+      if (isspace(*c) != 0) {
+        c++;
+        break;
+      }
+
+      do {
+        c++;
+      } while (c < end && isValidForIdentifier(*c));
+
+      if (depth == 0) {
+        return c;
+      }
+    }
+  }
+
+  // The form is not balanced. Continue from the next `(` at the start of a
+  // line which is most likely the next top level form.
+  auto rest = llvm::StringRef(formStart, static_cast<size_t>(end - formStart));
+  auto pos  = rest.find("\n(");
+
+  return pos == llvm::StringRef::npos ? end : formStart + pos + 1;
+};
+
+// ============================================================================
+// StreamReader
+// ============================================================================
+size_t StreamReader::scan() {
+  size_t boundary = 0;
+
+  for (; scanned < pending.size(); scanned++) {
+    auto c    = pending[scanned];
+    auto prev = std::exchange(last, c);
+
+    switch (state) {
+    case ScanState::BlockComment:
+      if (prev == '#' && c == '|') {
+        commentDepth++;
+        last = 0;
+      } else if (prev == '|' && c == '#') {
+        last = 0;
+        if (--commentDepth == 0) {
+          state = ScanState::Code;
+          if (depth == 0 && !afterPrefix) {
+            boundary = scanned + 1;
+          }
+        }
+      }
+      continue;
+
+    case ScanState::Comment:
+      if (c == '\n') {
+        state = ScanState::Code;
+        if (depth == 0 && !afterPrefix) {
+          boundary = scanned + 1;
+        }
+      }
+      continue;
+
+    case ScanState::String:
+      if (c == '\\') {
+        state = ScanState::StringEscape;
+      } else if (c == '"') {
+        state = ScanState::Code;
+        if (depth == 0) {
+          boundary = scanned + 1;
+        }
+      }
+      continue;
+
+    case ScanState::StringEscape:
+      state = ScanState::String;
+      continue;
+
+    case ScanState::Code:
+      break;
+    }
+
+    switch (c) {
+    case '(':
+    case '[':
+    case '{':
+    case ';':
+    case '"':
+      if (depth == 0 && !afterPrefix) {
+        // Whatever was before the collection, comment or string is complete
+        boundary = scanned;
+      }
+
+      if (c == ';') {
+        state = ScanState::Comment;
+      } else {
+        // The form of the prefix starts here
+        afterPrefix = false;
+
+        if (c == '"') {
+          state = ScanState::String;
+        } else {
+          depth++;
+        }
+      }
+      break;
+
+    case '\'':
+    case '`':
+    case '~':
+    case ',':
+      if (depth == 0) {
+        afterPrefix = true;
+      }
+      break;
+
+    case '|':
+      if (prev == '#') {
+        // Whatever was before the `#` is complete
+        if (depth == 0 && !afterPrefix) {
+          boundary = scanned - 1;
+        }
+
+        state        = ScanState::BlockComment;
+        commentDepth = 1;
+        last         = 0;
+      }
+      break;
+
+    case ')':
+    case ']':
+    case '}':
+      // An extra `)` at the top level is a complete (but invalid) form
+      // and the reader will take care of it.
+      if (depth > 0) {
+        depth--;
+      }
+
+      if (depth == 0) {
+        boundary    = scanned + 1;
+        afterPrefix = false;
+      }
+      break;
+
+    case '#':
+      // It might be the start of a block comment
+      break;
+
+    case '@':
+      // It's a part of the `~@` and `,@` prefixes
+      if (prev != '~' && prev != ',') {
+        afterPrefix = false;
+      }
+      break;
+
+    default:
+      if (isspace(c) == 0) {
+        // A token is a form by itself, even after a prefix
+        afterPrefix = false;
+        break;
+      }
+
+      // A token at the top level might continue in the next chunk but a
+      // whitespace ends it for sure. The prefixes can have whitespace
+      // between them and their forms though.
+      if (depth == 0 && !afterPrefix) {
+        boundary = scanned + 1;
+      }
+    }
+  }
+
+  return boundary;
+};
+
+ast::Ast StreamReader::readUpTo(size_t end) {
+  llvm::StringRef input(pending.data(), end);
+  Reader r(input, ns, filename, start);
+  // `pending` doesn't outlive the AST
+  r.ownStrings();
+  r.recoverFromErrors();
+
+  // The reader never fails in the recovery mode
+  auto tree = llvm::cantFail(r.read());
+
+  // Keep the good forms and set the broken ones aside
+  ast::Ast forms;
+  forms.reserve(tree.size() - r.getErrors().size());
+
+  for (auto &node : tree) {
+    if (llvm::isa<ast::Error>(node.get())) {
+      errors.push_back(std::move(node));
+    } else {
+      forms.push_back(std::move(node));
+    }
+  }
+
+  // Move the start location to the first char after the consumed input
+  for (auto c : input) {
+    if (c == '\n') {
+      start.line++;
+      start.col = 1;
+    } else {
+      start.col++;
+    }
+  }
+
+  pending.erase(0, end);
+  scanned -= end;
+
+  return forms;
+};
+
+ast::Ast StreamReader::feed(llvm::StringRef chunk) {
+  pending.append(chunk.begin(), chunk.end());
+
+  auto end = scan();
+  if (end == 0) {
+    return ast::Ast();
+  }
+
+  return readUpTo(end);
+};
+
+bool StreamReader::needsMoreInput() const {
+  // The scanner already knows whether it's in the middle of a form
+  return depth > 0 || state != ScanState::Code || afterPrefix;
+};
+
+ast::Ast StreamReader::finish() {
+  auto forms = readUpTo(pending.size());
+  reset();
+  return forms;
+};
+
+void StreamReader::reset() {
+  pending.clear();
+  scanned = 0;
+  depth   = 0;
+  state   = ScanState::Code;
+
+  commentDepth = 0;
+  last         = 0;
+  afterPrefix  = false;
+};
+
+/// `readParallel` doesn't split the inputs smaller than this. Reading less
+/// than this is faster than spawning a thread for it.
+constexpr static size_t MIN_PARALLEL_READ_CHUNK_SIZE = 256 * 1024;
+
+/// The start of a chunk of the input for `readParallel`
+struct Chunk {
+  size_t begin;
+  /// The line number of the first char of the chunk
+  unsigned line;
+};
+
+/// Split the given \p input into at most \p numOfChunks chunks of top level
+/// forms with roughly the same size. It only tracks the nesting level and
+/// the strings and comments (parens in them don't count) and cuts the input
+/// at the first newline of the top level after the target size of each
+/// chunk, so every chunk starts at the beginning of a line.
+static std::vector<Chunk> findChunks(llvm::StringRef input,
+                                     size_t numOfChunks) {
+  std::vector<Chunk> chunks{{0, 1}};
+  chunks.reserve(numOfChunks);
+
+  auto chunkSize = input.size() / numOfChunks;
+  auto target    = chunkSize;
+
+  int depth     = 0;
+  unsigned line = 1;
+  // The last char that is not a whitespace. A reader macro prefix like
+  // `'` belongs to the form on the next line.
+  char last = 0;
+
+  for (size_t i = 0; i < input.size(); i++) {
+    auto c = input[i];
+
+    switch (c) {
+    case '\n':
+      line++;
+
+      if (depth == 0 && i >= target && chunks.size() < numOfChunks &&
+          llvm::StringRef("'`~,@").find(last) == llvm::StringRef::npos) {
+        chunks.push_back({i + 1, line});
+        target = i + 1 + chunkSize;
+      }
+      continue;
+
+    case ';': {
+      auto eol = input.find('\n', i);
+      i        = eol == llvm::StringRef::npos ? input.size() : eol - 1;
+      continue;
+    }
+
+    case '#': {
+      if (input.substr(i).startswith("#|")) {
+        const auto *begin = input.data() + i;
+        const auto *end   = skipBlockComment(begin, input.end());
+
+        if (end == nullptr) {
+          end = input.end();
+        }
+
+        line += static_cast<unsigned>(std::count(begin, end, '\n'));
+        i += static_cast<size_t>(end - begin) - 1;
+        continue;
+      }
+      break;
+    }
+
+    case '"':
+      for (i++; i < input.size() && input[i] != '"'; i++) {
+        if (input[i] == '\\') {
+          i++;
+        }
+
+        if (i < input.size() && input[i] == '\n') {
+          line++;
+        }
+      }
+      break;
+
+    case '(':
+    case '[':
+    case '{':
+      depth++;
+      break;
+
+    case ')':
+    case ']':
+    case '}':
+      // The input is broken from here on, so the rest of it goes to the
+      // last chunk and the reader of that chunk reports the error.
+      if (--depth < 0) {
+        return chunks;
+      }
+      break;
+
+    default:
+      if (isspace(c) != 0) {
+        continue;
+      }
+      break;
+    }
+
+    last = c;
+  }
+
+  return chunks;
+};
+
+ast::MaybeAst readParallel(llvm::StringRef input, llvm::StringRef ns,
+                           std::optional<llvm::StringRef> filename,
+                           unsigned numOfThreads) {
+  auto strategy = llvm::hardware_concurrency(numOfThreads);
+  auto numOfChunks =
+      std::min<size_t>(strategy.compute_thread_count(),
+                       input.size() / MIN_PARALLEL_READ_CHUNK_SIZE);
+
+  if (numOfChunks < 2) {
+    return read(input, ns, filename);
+  }
+
+  auto chunks = findChunks(input, numOfChunks);
+
+  if (chunks.size() < 2) {
+    return read(input, ns, filename);
+  }
+
+  READER_LOG("Reading the input in " << chunks.size() << " chunks");
+
+  std::vector<std::optional<ast::MaybeAst>> results(chunks.size());
+
+  {
+    llvm::ThreadPool pool(strategy);
+
+    for (size_t i = 0; i < chunks.size(); i++) {
+      pool.async([&, i] {
+        auto end = i + 1 == chunks.size() ? input.size() : chunks[i + 1].begin;
+        Reader r(input.slice(chunks[i].begin, end), ns, filename,
+                 Location(ns, filename, nullptr, chunks[i].line, 1));
+        results[i].emplace(r.read());
+      });
+    }
+
+    pool.wait();
+  }
+
+  // Just like `read`, the first error in the input wins
+  size_t numOfForms = 0;
+  std::optional<llvm::Error> err;
+
+  for (auto &result : results) {
+    if (!*result) {
+      if (err) {
+        llvm::consumeError(result->takeError());
+      } else {
+        err.emplace(result->takeError());
+      }
+      continue;
+    }
+
+    numOfForms += (*result)->size();
+  }
+
+  if (err) {
+    return std::move(*err);
+  }
+
+  ast::Ast tree;
+  tree.reserve(numOfForms);
+
+  for (auto &result : results) {
+    std::move((*result)->begin(), (*result)->end(), std::back_inserter(tree));
+  }
+
+  return tree;
+};
+
 ast::MaybeAst read(const llvm::StringRef input, llvm::StringRef ns,
                    std::optional<llvm::StringRef> filename) {
   Reader r(input, ns, filename);
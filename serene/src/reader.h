@@ -31,18 +31,36 @@
  *
  * We have dedicated methods to read different forms like `list`, `symbol`
  * `number` and etc. Each of them return a `MaybeNode` that in the success
- * case contains the node and an `Error` on the failure case.
+ * case contains the node and an `Error` on the failure case. `readExpr`
+ * picks the method via `dispatchTable` that is indexed by the first char of
+ * the form. Reader macros like `'` and `~@` are in the same table and read
+ * the form after them directly into the expanded list, e.g. `'a` becomes
+ * `(quote a)`.
+ *
+ * `StreamReader` is a push based wrapper around `Reader` for the inputs that
+ * arrive in chunks (REPL, pipes, etc). It only runs a `Reader` on the part
+ * of the input that contains complete top level forms.
+ *
+ * `readParallel` is for the big inputs. It quickly scans the input for the
+ * top level forms and reads groups of them on separate threads.
  */
 
 #ifndef READER_H
 #define READER_H
 
+#include "_errors.h"
 #include "ast/ast.h"
 #include "location.h"
 
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/DenseMap.h>
 #include <llvm/ADT/StringRef.h>
 #include <llvm/Support/MemoryBufferRef.h>
 
+#include <array>
+#include <utility>
+#include <vector>
+
 #define READER_LOG(...)                  \
   DEBUG_WITH_TYPE("READER", llvm::dbgs() \
                                 << "[READER]: " << __VA_ARGS__ << "\n");
@@ -52,6 +70,12 @@ namespace jit {
 class JIT;
 } // namespace jit
 
+/// The byte range of a top level form in the input buffer of the reader
+struct FormRange {
+  size_t begin;
+  size_t end;
+};
+
 /// Base reader class which reads from a string directly.
 class Reader {
 private:
@@ -62,14 +86,29 @@ private:
 
   llvm::StringRef buf;
 
-  /// The position tracker that we will use to determine the end of the
-  /// buffer since the buffer might not be null terminated
-  size_t currentPos = static_cast<size_t>(-1);
-
   Location currentLocation;
 
   bool readEOL = false;
 
+  /// Whether the string nodes can point directly to the buffer or they have
+  /// to own their content. Look at `ownStrings`.
+  bool borrowStrings = true;
+
+  /// A reusable buffer to unescape the strings in.
+  std::string scratch;
+
+  /// Whether to keep the doc comments or not. Look at `keepDocComments`.
+  bool keepDocs = false;
+  /// The doc comment that we passed over but didn't attach to a node yet
+  llvm::StringRef pendingDoc;
+  /// The char that `pendingDoc` is right before
+  const char *pendingDocTarget = nullptr;
+  llvm::DenseMap<const ast::Expression *, llvm::StringRef> docs;
+
+  /// Return the first char starting from \p c that is not a whitespace or
+  /// a part of a comment.
+  const char *skipTrivia(const char *c) const;
+
   /// Returns a clone of the current location
   Location getCurrentLocation();
   /// Returns the next character from the stream.
@@ -77,6 +116,8 @@ private:
   /// or not
   void advance(bool skipWhitespace = false);
   void advanceByOne();
+  /// Move forward to the given char \p c in the buffer in one go.
+  void advanceTo(const char *c);
 
   const char *nextChar(bool skipWhitespace = false, unsigned count = 1);
 
@@ -90,18 +131,105 @@ private:
   ast::MaybeNode readSymbol();
   ast::MaybeNode readNumber(bool);
   ast::MaybeNode readList();
+  ast::MaybeNode readString();
+  ast::MaybeNode readVector();
+  ast::MaybeNode readMap();
+  ast::MaybeNode readQuote();
+  ast::MaybeNode readQuasiquote();
+  ast::MaybeNode readUnquote();
   ast::MaybeNode readExpr();
 
+  /// The byte ranges of the top level forms that we read so far
+  std::vector<FormRange> formRanges;
+
+  /// Whether to recover from the errors or not. Look at `recoverFromErrors`.
+  bool recover = false;
+  std::vector<const ast::Error *> errorNodes;
+
+  /// Turn the given \p err of a top level form that starts at \p formStart
+  /// to an error node.
+  std::unique_ptr<ast::Error> makeErrorNode(llvm::Error err,
+                                            const Location &formStart);
+
+  /// Return the position that the reader has to continue from after failing
+  /// to read the form that starts at \p formStart. It is right after the
+  /// form if it is balanced or the next `(` at the start of a line.
+  const char *findResyncPoint(const char *formStart) const;
+
+  /// The elements of the vectors and maps that are being read. The elements
+  /// of a nested collection go on top of the ones of its parent and they
+  /// are moved to the collection once it's closed, so we know its size
+  /// before creating it.
+  ast::Ast elementStack;
+
+  /// Reads the elements of a collection till the \p close char onto the
+  /// `elementStack` and returns their number. The end of \p loc is set to
+  /// the closing char.
+  llvm::Expected<size_t> readElements(LocationRange &loc, char close,
+                                      errors::Type eofError);
+
+  /// Move the top \p count elements of the `elementStack` to \p coll.
+  void popElements(ast::Collection &coll, size_t count);
+
+  /// Reads the form after a reader macro of \p prefixLength chars and
+  /// expands it to `(name form)`
+  ast::MaybeNode readMacroForm(llvm::StringRef name, unsigned prefixLength);
+
+  /// The functions that read a form based on its first char
+  using ReaderFn = ast::MaybeNode (Reader::*)();
+
+  /// Maps the first char of a form to the function that reads it. Chars
+  /// that are not in the table start a symbol (or a number).
+  static const std::array<ReaderFn, 256> dispatchTable;
+
   bool isEndOfBuffer(const char *);
 
 public:
   Reader(llvm::StringRef buf, llvm::StringRef ns,
          std::optional<llvm::StringRef> filename);
+  /// Create a reader for the given \p buf that is a part of a bigger input
+  /// and the first char of it is at the given \p start location of that
+  /// input. Locations of the nodes will be relative to the bigger input.
+  Reader(llvm::StringRef buf, llvm::StringRef ns,
+         std::optional<llvm::StringRef> filename, const Location &start);
   Reader(llvm::MemoryBufferRef buf, llvm::StringRef ns,
          std::optional<llvm::StringRef> filename);
 
   // void setInput(const llvm::StringRef string);
 
+  /// By default, string nodes point directly to the input buffer unless they
+  /// contain escape sequences. Call this function if the buffer doesn't
+  /// outlive the AST to make the string nodes own their content.
+  void ownStrings() { borrowStrings = false; };
+
+  /// By default, `read` stops at the first error. In the recovery mode, the
+  /// reader replaces any broken top level form with an `ast::Error` node and
+  /// continues from the next top level form. So `read` always returns an
+  /// AST and the errors are available via `getErrors`. It's useful for tools
+  /// like the LSP server that need to deal with the incomplete code.
+  void recoverFromErrors() { recover = true; };
+
+  /// Return the error nodes of the AST that are created in the recovery mode
+  llvm::ArrayRef<const ast::Error *> getErrors() const { return errorNodes; };
+
+  /// Return the byte range of each top level form of the AST in the input
+  /// buffer. The range of an error node in the recovery mode covers the
+  /// whole input that the reader skipped.
+  llvm::ArrayRef<FormRange> getFormRanges() const { return formRanges; };
+
+  /// Comments are skipped like whitespace by default. Call this function
+  /// to keep the doc comments (lines starting with `;;;`) that come right
+  /// before a form. The comments point to the buffer and are available via
+  /// `getDocComments` after reading the input.
+  void keepDocComments() { keepDocs = true; };
+
+  /// Return the doc comments (including the semicolons) of the nodes that
+  /// had any.
+  const llvm::DenseMap<const ast::Expression *, llvm::StringRef> &
+  getDocComments() const {
+    return docs;
+  };
+
   /// Parses the the input and creates a possible AST out of it or errors
   /// otherwise.
   ast::MaybeAst read();
@@ -109,12 +237,114 @@ public:
   ~Reader();
 };
 
+/// A push based reader for the times that the input is not available all at
+/// once, e.g. the REPL or a network socket. Chunks of the input are pushed
+/// to the reader via `feed` and the reader returns the top level forms as
+/// soon as they are complete. Unfinished forms stay in the reader until
+/// the rest of them arrive and the reader never re-reads a form that it
+/// already returned.
+///
+/// A broken form doesn't affect the other forms around it. The reader runs
+/// in the recovery mode and the errors of the broken forms are kept aside
+/// until they are taken via `takeErrors`.
+///
+/// Here is an example:
+/// \code
+/// StreamReader r("user", std::nullopt);
+/// auto forms = r.feed("(def a 1) (def b");  // -> (def a 1)
+/// r.needsMoreInput();                       // -> true
+/// forms      = r.feed(" 2) )\n");           // -> (def b 2)
+/// r.takeErrors();                           // -> the error of `)`
+/// \endcode
+class StreamReader {
+  llvm::StringRef ns;
+  std::optional<llvm::StringRef> filename;
+
+  /// The part of the input that is not read yet
+  std::string pending;
+
+  /// How far we scanned the `pending` to find the end of the top level
+  /// forms. So we don't have to scan the same part on every `feed`.
+  size_t scanned = 0;
+  /// The nesting level of lists at the `scanned` position
+  unsigned depth = 0;
+
+  /// Parens inside of strings and comments don't count
+  enum class ScanState { Code, String, StringEscape, Comment, BlockComment };
+  ScanState state = ScanState::Code;
+  /// The nesting level of block comments at the `scanned` position
+  unsigned commentDepth = 0;
+  /// The char before the `scanned` position, so we can find the `#|` and
+  /// `|#` pairs across the chunks. It's zero if the char is already a part
+  /// of a pair.
+  char last = 0;
+  /// Whether there is a reader macro prefix like `'` at the top level that
+  /// its form is not started yet. The prefix and its form are one form.
+  bool afterPrefix = false;
+
+  /// The location of the first char of `pending` in the whole input
+  Location start;
+
+  /// Scan the pending input from where we left off and return the position
+  /// right after the last complete top level form or zero if there is none.
+  size_t scan();
+
+  /// The error nodes of the broken forms that are not taken yet
+  ast::Ast errors;
+
+  /// Read the first \p end chars of the pending input and drop them.
+  ast::Ast readUpTo(size_t end);
+
+public:
+  StreamReader(llvm::StringRef ns, std::optional<llvm::StringRef> filename)
+      : ns(ns), filename(filename), start(ns, filename, nullptr, 1, 1){};
+
+  /// Push the given \p chunk to the reader and return the top level forms
+  /// that are completed so far. It might be empty if there is no complete
+  /// form yet. The erroneous forms will be dropped and their errors are
+  /// available via `takeErrors`.
+  ast::Ast feed(llvm::StringRef chunk);
+
+  /// Return the error nodes of the broken forms that are read so far and
+  /// forget about them.
+  ast::Ast takeErrors() { return std::exchange(errors, {}); };
+
+  /// Return a boolean indicating whether there is an unfinished form in the
+  /// reader that needs more input to complete.
+  bool needsMoreInput() const;
+
+  /// Signal the end of the input and read whatever is left in the reader.
+  /// Unfinished lists will result in an error.
+  ast::Ast finish();
+
+  /// Drop the pending input and start over.
+  void reset();
+};
+
+/// Return the position right after the block comment (`#| ... |#`) that
+/// starts at \p c or `nullptr` if it's not terminated before \p end. Block
+/// comments can be nested.
+const char *skipBlockComment(const char *c, const char *end);
+
 /// Parses the given `input` string and returns a `Result<ast>`
-/// which may contains an AST or an `llvm::Error`
+/// which may contains an AST or an `llvm::Error`. String nodes of the AST
+/// might point to the `input`, so it has to outlive the AST.
 ast::MaybeAst read(llvm::StringRef input, llvm::StringRef ns,
                    std::optional<llvm::StringRef> filename);
 ast::MaybeAst read(llvm::MemoryBufferRef input, llvm::StringRef ns,
                    std::optional<llvm::StringRef> filename);
 
+/// Parses the given `input` just like `read` but in parallel. The input is
+/// split into chunks of complete top level forms and each chunk is read by
+/// a separate `Reader` on a thread of its own. The locations of the nodes
+/// are the same as `read` and in case of an error, it returns the first
+/// error in the input. Small inputs are read on the current thread.
+///
+/// \p numOfThreads is the maximum number of threads to use, zero means as
+/// many as the hardware supports.
+ast::MaybeAst readParallel(llvm::StringRef input, llvm::StringRef ns,
+                           std::optional<llvm::StringRef> filename,
+                           unsigned numOfThreads = 0);
+
 } // namespace serene
 #endif
@@ -0,0 +1,121 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Commentary:
+ * The `gc.h` interface on top of the conservative Boehm GC. It's only used
+ * if Serene is built with `SERENE_WITH_BDWGC`. The Boehm GC scans the
+ * stacks and the heap conservatively, so there's no need for the write
+ * barrier and the stack maps, and the layouts only tell it which objects
+ * have no references at all.
+ */
+
+#include "runtime/gc.h"
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/Support/ErrorHandling.h>
+
+#include <gc.h>
+
+#include <cassert>
+#include <mutex>
+
+namespace serene::runtime {
+
+static void init() {
+  static std::once_flag flag;
+  std::call_once(flag, []() { GC_INIT(); });
+};
+
+void *allocate(size_t size, Layout layout) {
+  init();
+
+  auto *ret =
+      layout == Layout::Raw ? GC_MALLOC_ATOMIC(size) : GC_MALLOC(size);
+
+  if (ret == nullptr) {
+    llvm::report_bad_alloc_error("Failed to allocate a GC object");
+  }
+
+  return ret;
+};
+
+void writeBarrier(const void * /*object*/){};
+
+void collect(bool major) {
+  init();
+
+  if (major) {
+    GC_gcollect();
+  } else {
+    GC_collect_a_little();
+  }
+};
+
+/// The Boehm GC needs the size of a root to remove it
+static std::mutex rootsLock;
+static llvm::DenseMap<void *, size_t> rootSizes;
+
+void addRoot(void *object, Layout /*layout*/, size_t size) {
+  init();
+
+  std::lock_guard<std::mutex> guard(rootsLock);
+  rootSizes[object] = size;
+  GC_add_roots(object, static_cast<char *>(object) + size);
+};
+
+void removeRoot(void *object) {
+  std::lock_guard<std::mutex> guard(rootsLock);
+
+  auto it = rootSizes.find(object);
+  assert(it != rootSizes.end() && "Unknown root");
+
+  GC_remove_roots(object, static_cast<char *>(object) + it->second);
+  rootSizes.erase(it);
+};
+
+// The Boehm GC scans the stacks conservatively, so it doesn't need to know
+// where the threads are
+NativeScope::NativeScope() = default;
+NativeScope::~NativeScope() = default;
+
+JITCall::JITCall() = default;
+JITCall::~JITCall() = default;
+
+void registerStackMaps(llvm::ArrayRef<uint8_t> /*section*/){};
+
+GCStats getGCStats() {
+  GCStats stats;
+  stats.numOfMajorCollections = GC_get_gc_no();
+  stats.oldBytes              = GC_get_heap_size();
+  return stats;
+};
+
+} // namespace serene::runtime
+
+extern "C" void __serene_gc_safepoint(){};
+
+extern "C" serene::runtime::TLAB *__serene_gc_get_tlab() {
+  // The buffer stays empty, so the JIT'd code always takes the slow path
+  return &serene::runtime::currentTLAB;
+};
+
+extern "C" void *__serene_gc_allocate(uint64_t size, uint8_t layout) {
+  return serene::runtime::allocate(
+      size, static_cast<serene::runtime::Layout>(layout));
+};
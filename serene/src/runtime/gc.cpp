@@ -0,0 +1,1015 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "runtime/gc.h"
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Object/StackMapParser.h>
+#include <llvm/Support/Compiler.h>
+#include <llvm/Support/ErrorHandling.h>
+#include <llvm/Support/MathExtras.h>
+#include <llvm/Support/MemAlloc.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+namespace serene::runtime {
+
+constexpr size_t BLOCK_SIZE        = 32 * 1024;
+constexpr size_t LINE_SIZE         = 256;
+constexpr size_t LINES_PER_BLOCK   = BLOCK_SIZE / LINE_SIZE;
+
+/// The nursery asks for a collection once it reaches this size
+constexpr size_t NURSERY_SIZE = 4 * 1024 * 1024;
+/// The major collections don't run before the old generation reaches this
+/// size
+constexpr size_t MIN_MAJOR_THRESHOLD = 32 * 1024 * 1024;
+/// Free blocks more than this are returned to the system
+constexpr size_t MAX_FREE_BLOCKS = 2 * NURSERY_SIZE / BLOCK_SIZE;
+
+/// The id of the statepoint records in the stack maps
+constexpr uint64_t STATEPOINT_ID = 0xABCDEF00;
+
+// Object headers =============================================================
+enum HeaderFlags : uint8_t {
+  OLD        = 0x1,
+  REMEMBERED = 0x2,
+  /// The object is copied and its first word points to the copy
+  FORWARDED = 0x4,
+  /// The object is marked if this bit is the same as the current epoch
+  MARK = 0x8,
+};
+
+static Header *getHeader(uint64_t ptr) {
+  return reinterpret_cast<Header *>(ptr) - 1;
+};
+
+static uint64_t getPayload(const Header *h) {
+  return reinterpret_cast<uint64_t>(h + 1);
+};
+
+// The slots are fields of the runtime structs with different types, so
+// we access them as plain words.
+static uint64_t loadSlot(const void *slot) {
+  uint64_t w = 0;
+  std::memcpy(&w, slot, sizeof(w));
+  return w;
+};
+
+static void storeSlot(void *slot, uint64_t w) {
+  std::memcpy(slot, &w, sizeof(w));
+};
+
+static bool isPointer(uint64_t w) {
+  return w != 0 && (w & SERENE_TAG_MASK) == SERENE_POINTER_TAG;
+};
+
+/// Call \p fn with the address of each reference of the \p size bytes
+/// at \p object with the given \p layout.
+template <typename Fn>
+static void forEachRef(void *object, Layout layout, size_t size, Fn &&fn) {
+  switch (layout) {
+  case Layout::Raw:
+    return;
+
+  case Layout::Values: {
+    auto *words = static_cast<uint64_t *>(object);
+    for (size_t i = 0; i < size / sizeof(uint64_t); i++) {
+      fn(&words[i]);
+    }
+    return;
+  }
+
+  case Layout::Object:
+    fn(&static_cast<Object *>(object)->data);
+    return;
+
+  case Layout::Pair: {
+    auto *p = static_cast<Pair *>(object);
+    fn(&p->first);
+    fn(&p->second);
+    return;
+  }
+
+  case Layout::String: {
+    auto *str = static_cast<String *>(object);
+
+    if (str->kind == SERENE_STRING_INLINE) {
+      return;
+    }
+
+    fn(&str->data);
+
+    // The halves of a flattened rope are never used again, so they are
+    // left to die
+    if (str->kind == SERENE_STRING_ROPE && str->data == nullptr) {
+      auto *rope = static_cast<Rope *>(object);
+      fn(&rope->left);
+      fn(&rope->right);
+    }
+    return;
+  }
+
+  case Layout::List:
+    fn(&static_cast<List *>(object)->chunk);
+    return;
+
+  case Layout::ListChunk: {
+    auto *c = static_cast<ListChunk *>(object);
+    fn(&c->next);
+
+    // The slots before `front` are not used yet
+    for (auto i = __atomic_load_n(&c->front, __ATOMIC_ACQUIRE);
+         i < c->capacity; i++) {
+      fn(&c->elements[i]);
+    }
+    return;
+  }
+
+  case Layout::Vector: {
+    auto *v = static_cast<Vector *>(object);
+    fn(&v->root);
+    fn(&v->tail);
+    return;
+  }
+
+  case Layout::VectorNode: {
+    // The values of the leaves and the children of the inner nodes are all
+    // references
+    auto *n = static_cast<VectorNode *>(object);
+    for (auto &child : n->children) {
+      fn(&child);
+    }
+    return;
+  }
+
+  case Layout::Map:
+    fn(&static_cast<Map *>(object)->root);
+    return;
+
+  case Layout::MapNode: {
+    auto *n    = static_cast<MapNode *>(object);
+    auto *keys = n->slots + n->entryCapacity;
+
+    for (unsigned i = 0; i < n->numOfEntries; i++) {
+      fn(&keys[i]);
+      fn(&keys[n->entryCapacity + i]);
+    }
+
+    auto *nodes = keys + (2 * n->entryCapacity);
+    for (unsigned i = 0; i < n->numOfNodes; i++) {
+      fn(&nodes[i]);
+    }
+    return;
+  }
+  }
+};
+
+template <typename Fn>
+static void forEachRef(Header *h, Fn &&fn) {
+  forEachRef(h + 1, h->layout, h->size - sizeof(Header), fn);
+};
+
+// Blocks =====================================================================
+struct Block {
+  enum class Kind : uint8_t { Free, Nursery, Old };
+
+  char *start;
+  Kind kind = Kind::Free;
+  /// Only for the old blocks. A line is marked if it has a live object or
+  /// a promoted one since the last major collection.
+  uint8_t lines[LINES_PER_BLOCK];
+
+  void markLines(const Header *h) {
+    // The header is always in this block, so its offset is never negative
+    auto offset =
+        static_cast<size_t>(reinterpret_cast<const char *>(h) - start);
+    auto first = offset / LINE_SIZE;
+    auto last  = (offset + h->size - 1) / LINE_SIZE;
+    std::memset(&lines[first], 1, last - first + 1);
+  };
+};
+
+// Stack maps =================================================================
+/// A slot of a JIT'd frame relative to its stack or frame pointer
+struct StackSlot {
+  bool fromFP;
+  int32_t offset;
+};
+
+/// The live references of a JIT'd frame at a statepoint
+struct Safepoint {
+  /// Each reference is a base pointer and a (maybe the same) pointer
+  /// derived from it
+  llvm::SmallVector<std::pair<StackSlot, StackSlot>, 4> refs;
+};
+
+/// The state of a JIT'd frame at the call to a statepoint
+struct Frame {
+  /// The address that the callee returns to, zero means no frame
+  uintptr_t returnAddress = 0;
+  /// The stack pointer of the frame right before the call
+  uintptr_t sp = 0;
+  uintptr_t fp = 0;
+};
+
+// Mutators ===================================================================
+/// A thread that uses the heap
+struct Mutator {
+  enum class State : uint8_t {
+    /// It runs the Serene code and has to stop at a safepoint for the
+    /// collections
+    Running,
+    /// It's stopped at a safepoint while another thread collects
+    Parked,
+    /// It doesn't touch any runtime value, look at `NativeScope`
+    Native,
+  };
+
+  /// The allocation buffer of the thread. Only the thread itself changes
+  /// it, the collector never does.
+  TLAB *tlab;
+  State state = State::Running;
+  /// The JIT'd frames of a parked thread from its safepoint up
+  Frame frame;
+  /// The calls into the JIT'd code on the stack of the thread
+  unsigned numOfJITCalls = 0;
+
+  explicit Mutator(TLAB *tlab) : tlab(tlab){};
+};
+
+// The collector ==============================================================
+class Heap {
+  std::mutex lock;
+  /// The collecting thread waits on it for the others to stop
+  std::condition_variable stopped;
+  /// The stopped threads wait on it for the end of the collection
+  std::condition_variable resumed;
+  /// A thread is collecting and the others have to stop at their next
+  /// safepoint
+  bool stopping = false;
+  std::vector<Mutator *> mutators;
+
+  /// All the blocks by their address divided by the block size. The
+  /// addresses themselves would collide in the hash of the `DenseMap`.
+  llvm::DenseMap<uintptr_t, Block *> blocks;
+  std::vector<Block *> freeBlocks;
+
+  std::vector<Block *> nursery;
+
+  std::vector<Block *> oldBlocks;
+  /// The old blocks with free lines after the last major collection
+  std::vector<Block *> recyclable;
+  size_t nextRecyclable = 0;
+  /// The current hole of the old generation
+  Block *oldBlock = nullptr;
+  size_t nextLine = 0;
+  char *oldCursor = nullptr;
+  char *oldLimit  = nullptr;
+
+  std::vector<Header *> largeObjects;
+  llvm::DenseSet<uintptr_t> largeObjectSet;
+  size_t largeObjectBytes = 0;
+
+  std::vector<Header *> remembered;
+
+  struct RootEntry {
+    void *object;
+    Layout layout;
+    size_t size;
+  };
+  std::vector<RootEntry> roots;
+
+  llvm::DenseMap<uintptr_t, Safepoint> safepoints;
+
+  std::vector<Header *> worklist;
+
+  std::atomic<bool> collectionRequested{false};
+  uint8_t markEpoch     = 0;
+  size_t majorThreshold = MIN_MAJOR_THRESHOLD;
+
+  GCStats stats;
+
+  Block *getBlock(uint64_t ptr) const {
+    return blocks.lookup(ptr / BLOCK_SIZE);
+  };
+
+  size_t getOldBytes() const {
+    return (oldBlocks.size() * BLOCK_SIZE) + largeObjectBytes;
+  };
+
+  Block *newBlock(Block::Kind kind);
+  void releaseBlock(Block *b);
+
+  void *allocateLarge(size_t size, Layout layout);
+  bool nextHole();
+  Header *allocateOld(size_t size);
+
+  template <typename Fn>
+  void walkStack(Frame frame, Fn &&fn);
+
+  void forward(void *slot);
+  void mark(void *slot);
+
+  void minor(llvm::ArrayRef<Frame> frames);
+  void major(llvm::ArrayRef<Frame> frames);
+  void sweep();
+
+  bool isStopped(const Mutator &self) const;
+  void park(Mutator &self, Frame frame, std::unique_lock<std::mutex> &guard);
+
+public:
+  void *allocateSlow(size_t size, Layout layout);
+  void remember(Header *h);
+
+  void addMutator(Mutator *m);
+  void removeMutator(Mutator *m);
+  void leaveSerene(Mutator &self);
+  void enterSerene(Mutator &self);
+
+  void addRoot(void *object, Layout layout, size_t size);
+  void removeRoot(void *object);
+
+  void registerStackMaps(llvm::ArrayRef<uint8_t> section);
+
+  bool isCollectionRequested() const {
+    return collectionRequested.load(std::memory_order_relaxed);
+  };
+
+  void collect(Mutator &self, bool forceMajor, Frame frame);
+
+  GCStats getStats();
+};
+
+static Heap &getHeap() {
+  static Heap heap;
+  return heap;
+};
+
+Block *Heap::newBlock(Block::Kind kind) {
+  Block *b = nullptr;
+
+  if (!freeBlocks.empty()) {
+    b = freeBlocks.back();
+    freeBlocks.pop_back();
+  } else {
+    b        = new Block;
+    b->start = static_cast<char *>(std::aligned_alloc(BLOCK_SIZE, BLOCK_SIZE));
+
+    if (b->start == nullptr) {
+      llvm::report_bad_alloc_error("Failed to allocate a GC block");
+    }
+
+    blocks[reinterpret_cast<uintptr_t>(b->start) / BLOCK_SIZE] = b;
+  }
+
+  b->kind = kind;
+  std::memset(b->lines, 0, sizeof(b->lines));
+  return b;
+};
+
+void Heap::releaseBlock(Block *b) {
+  if (freeBlocks.size() < MAX_FREE_BLOCKS) {
+    b->kind = Block::Kind::Free;
+    freeBlocks.push_back(b);
+    return;
+  }
+
+  blocks.erase(reinterpret_cast<uintptr_t>(b->start) / BLOCK_SIZE);
+  std::free(b->start);
+  delete b;
+};
+
+void *Heap::allocateSlow(size_t size, Layout layout) {
+  std::lock_guard<std::mutex> guard(lock);
+
+  if (size > LARGE_OBJECT_SIZE) {
+    return allocateLarge(size, layout);
+  }
+
+  // The rest of the current buffer is wasted, it's less than the biggest
+  // small object
+  auto *b = newBlock(Block::Kind::Nursery);
+  nursery.push_back(b);
+
+  if (nursery.size() * BLOCK_SIZE >= NURSERY_SIZE) {
+    collectionRequested.store(true, std::memory_order_relaxed);
+  }
+
+  auto &tlab  = currentTLAB;
+  auto *h     = reinterpret_cast<Header *>(b->start);
+  tlab.cursor = b->start + size;
+  tlab.limit  = b->start + BLOCK_SIZE;
+
+  *h = Header{static_cast<uint32_t>(size), layout, 0, 0};
+  return h + 1;
+};
+
+void Heap::addMutator(Mutator *m) {
+  std::lock_guard<std::mutex> guard(lock);
+  mutators.push_back(m);
+};
+
+void Heap::removeMutator(Mutator *m) {
+  std::lock_guard<std::mutex> guard(lock);
+
+  // The block of the buffer stays in the nursery until the next collection
+  mutators.erase(std::find(mutators.begin(), mutators.end(), m));
+  stopped.notify_all();
+};
+
+void Heap::leaveSerene(Mutator &self) {
+  assert(self.numOfJITCalls == 0 &&
+         "The collector can't update the JIT'd frames of a native thread");
+
+  std::lock_guard<std::mutex> guard(lock);
+
+  // The nursery might be gone by the time the thread is back
+  *self.tlab = TLAB{};
+  self.state = Mutator::State::Native;
+  stopped.notify_all();
+};
+
+void Heap::enterSerene(Mutator &self) {
+  std::unique_lock<std::mutex> guard(lock);
+  resumed.wait(guard, [&] { return !stopping; });
+  self.state = Mutator::State::Running;
+};
+
+void *Heap::allocateLarge(size_t size, Layout layout) {
+  assert(size <= UINT32_MAX && "The object is too big");
+
+  auto *h = static_cast<Header *>(llvm::safe_malloc(size));
+  // It's empty now, but the caller is about to fill it with references to
+  // the young objects.
+  *h = Header{static_cast<uint32_t>(size), layout,
+              static_cast<uint8_t>(OLD | REMEMBERED | markEpoch), 0};
+
+  largeObjects.push_back(h);
+  largeObjectSet.insert(getPayload(h));
+  largeObjectBytes += size;
+  remembered.push_back(h);
+  return h + 1;
+};
+
+bool Heap::nextHole() {
+  while (true) {
+    if (oldBlock != nullptr) {
+      while (nextLine < LINES_PER_BLOCK && oldBlock->lines[nextLine] != 0) {
+        nextLine++;
+      }
+
+      if (nextLine < LINES_PER_BLOCK) {
+        auto first = nextLine;
+        while (nextLine < LINES_PER_BLOCK && oldBlock->lines[nextLine] == 0) {
+          nextLine++;
+        }
+
+        oldCursor = oldBlock->start + (first * LINE_SIZE);
+        oldLimit  = oldBlock->start + (nextLine * LINE_SIZE);
+        return true;
+      }
+    }
+
+    if (nextRecyclable == recyclable.size()) {
+      return false;
+    }
+
+    oldBlock = recyclable[nextRecyclable++];
+    nextLine = 0;
+  }
+};
+
+Header *Heap::allocateOld(size_t size) {
+  while (static_cast<size_t>(oldLimit - oldCursor) < size) {
+    if (!nextHole()) {
+      oldBlock = newBlock(Block::Kind::Old);
+      nextLine = 0;
+      oldBlocks.push_back(oldBlock);
+    }
+  }
+
+  auto *h = reinterpret_cast<Header *>(oldCursor);
+  oldCursor += size;
+  h->size = static_cast<uint32_t>(size);
+  // Mark the lines right away, so the next holes don't overwrite it
+  oldBlock->markLines(h);
+  return h;
+};
+
+void Heap::remember(Header *h) {
+  std::lock_guard<std::mutex> guard(lock);
+
+  if ((h->flags & REMEMBERED) == 0) {
+    h->flags |= REMEMBERED;
+    remembered.push_back(h);
+  }
+};
+
+void Heap::addRoot(void *object, Layout layout, size_t size) {
+  std::lock_guard<std::mutex> guard(lock);
+  roots.push_back({object, layout, size});
+};
+
+void Heap::removeRoot(void *object) {
+  std::lock_guard<std::mutex> guard(lock);
+
+  // The roots are mostly removed in the reverse order
+  auto it = std::find_if(roots.rbegin(), roots.rend(), [&](const auto &r) {
+    return r.object == object;
+  });
+
+  assert(it != roots.rend() && "Unknown root");
+  roots.erase(std::next(it).base());
+};
+
+// Stack maps =================================================================
+#if defined(__x86_64__)
+/// The DWARF register numbers of the stack and frame pointers
+constexpr uint16_t SP_REGISTER = 7;
+constexpr uint16_t FP_REGISTER = 6;
+#endif
+
+void Heap::registerStackMaps(llvm::ArrayRef<uint8_t> section) {
+#if defined(__x86_64__)
+  using Parser = llvm::StackMapParser<llvm::support::little>;
+  using Kind   = Parser::LocationKind;
+
+  if (auto err = Parser::validateHeader(section)) {
+    llvm::report_fatal_error(std::move(err));
+  }
+
+  Parser parser(section);
+
+  auto getSlot = [](const Parser::LocationAccessor &loc) {
+    if (loc.getKind() != Kind::Indirect) {
+      llvm::report_fatal_error("Unsupported location of a GC reference");
+    }
+
+    auto reg = loc.getDwarfRegNum();
+    if (reg != SP_REGISTER && reg != FP_REGISTER) {
+      llvm::report_fatal_error("Unsupported register of a GC reference");
+    }
+
+    return StackSlot{reg == FP_REGISTER, loc.getOffset()};
+  };
+
+  std::lock_guard<std::mutex> guard(lock);
+
+  unsigned recordIndex = 0;
+  for (const auto &fn : parser.functions()) {
+    auto address = fn.getFunctionAddress();
+
+    for (uint64_t i = 0; i < fn.getRecordCount(); i++) {
+      auto record = parser.getRecord(recordIndex++);
+
+      if (record.getID() != STATEPOINT_ID) {
+        continue;
+      }
+
+      // The first three locations are the calling convention, the flags
+      // and the number of the deopt locations. The GC references come
+      // after the deopt locations as (base, derived) pairs.
+      auto numOfLocations = record.getNumLocations();
+      auto first          = 3 + record.getLocation(2).getSmallConstant();
+
+      Safepoint sp;
+      for (auto j = first; j + 1 < numOfLocations; j += 2) {
+        auto base    = record.getLocation(j);
+        auto derived = record.getLocation(j + 1);
+
+        // A constant reference, e.g. `null`
+        if (base.getKind() == Kind::Constant ||
+            base.getKind() == Kind::ConstantIndex) {
+          continue;
+        }
+
+        sp.refs.push_back({getSlot(base), getSlot(derived)});
+      }
+
+      safepoints[address + record.getInstructionOffset()] = std::move(sp);
+    }
+  }
+#else
+  (void)section;
+  llvm::report_fatal_error("The GC stack maps are only supported on x86-64");
+#endif
+};
+
+/// Call \p fn with the address of the base and the derived slot of each
+/// reference of the JIT'd frames from the given \p frame up.
+template <typename Fn>
+void Heap::walkStack(Frame frame, Fn &&fn) {
+  while (frame.returnAddress != 0) {
+    auto it = safepoints.find(frame.returnAddress);
+
+    // We're out of the JIT'd code
+    if (it == safepoints.end()) {
+      return;
+    }
+
+    auto getAddress = [&](StackSlot s) {
+      // The slots relative to the frame pointer are below it and have
+      // negative offsets, so the offset has to be added as a signed int
+      auto base = static_cast<intptr_t>(s.fromFP ? frame.fp : frame.sp);
+      return reinterpret_cast<void *>(base + s.offset);
+    };
+
+    for (const auto &[base, derived] : it->second.refs) {
+      fn(getAddress(base), getAddress(derived));
+    }
+
+    // The frame pointer points to the saved frame pointer of the caller
+    // and the return address is right above it
+    const auto *fp = reinterpret_cast<const uintptr_t *>(frame.fp);
+    frame          = Frame{fp[1], frame.fp + (2 * sizeof(uintptr_t)), fp[0]};
+  }
+};
+
+// Collections ================================================================
+void Heap::forward(void *slot) {
+  auto w = loadSlot(slot);
+
+  if (!isPointer(w)) {
+    return;
+  }
+
+  auto *b = getBlock(w);
+  if (b == nullptr || b->kind != Block::Kind::Nursery) {
+    return;
+  }
+
+  auto *h = getHeader(w);
+
+  if ((h->flags & FORWARDED) == 0) {
+    auto *copy = allocateOld(h->size);
+    std::memcpy(copy, h, h->size);
+    copy->flags = static_cast<uint8_t>(OLD | markEpoch);
+
+    h->flags |= FORWARDED;
+    storeSlot(h + 1, getPayload(copy));
+
+    stats.promotedBytes += h->size;
+    worklist.push_back(copy);
+  }
+
+  storeSlot(slot, loadSlot(h + 1));
+};
+
+void Heap::mark(void *slot) {
+  auto w = loadSlot(slot);
+
+  if (!isPointer(w)) {
+    return;
+  }
+
+  auto *b = getBlock(w);
+  if (b == nullptr && !largeObjectSet.contains(w)) {
+    return;
+  }
+
+  assert((b == nullptr || b->kind == Block::Kind::Old) &&
+         "The nursery has to be empty on a major collection");
+
+  auto *h = getHeader(w);
+  if ((h->flags & MARK) == markEpoch) {
+    return;
+  }
+
+  h->flags = static_cast<uint8_t>((h->flags & ~MARK) | markEpoch);
+
+  if (b != nullptr) {
+    b->markLines(h);
+  }
+
+  worklist.push_back(h);
+};
+
+void Heap::minor(llvm::ArrayRef<Frame> frames) {
+  auto visit = [&](void *slot) { forward(slot); };
+
+  for (auto &r : roots) {
+    forEachRef(r.object, r.layout, r.size, visit);
+  }
+
+  // The derived pointers move along with their bases. A base can have more
+  // than one derived pointer, so keep the old bases before moving them.
+  struct DerivedRef {
+    void *base;
+    void *derived;
+    uint64_t oldBase;
+  };
+  std::vector<DerivedRef> derivedRefs;
+
+  for (const auto &frame : frames) {
+    walkStack(frame, [&](void *base, void *derived) {
+      if (base != derived) {
+        derivedRefs.push_back({base, derived, loadSlot(base)});
+      }
+    });
+  }
+
+  for (const auto &frame : frames) {
+    walkStack(frame, [&](void *base, void * /*derived*/) { forward(base); });
+  }
+
+  for (const auto &r : derivedRefs) {
+    storeSlot(r.derived,
+              loadSlot(r.derived) + (loadSlot(r.base) - r.oldBase));
+  }
+
+  for (auto *h : remembered) {
+    h->flags &= static_cast<uint8_t>(~REMEMBERED);
+    forEachRef(h, visit);
+  }
+  remembered.clear();
+
+  while (!worklist.empty()) {
+    auto *h = worklist.back();
+    worklist.pop_back();
+    forEachRef(h, visit);
+  }
+
+  for (auto *b : nursery) {
+    releaseBlock(b);
+  }
+
+  // The threads gave up their allocation buffers before the collection
+  nursery.clear();
+  stats.numOfMinorCollections++;
+};
+
+void Heap::major(llvm::ArrayRef<Frame> frames) {
+  assert(nursery.empty() &&
+         "The nursery has to be empty on a major collection");
+
+  // Flipping the epoch unmarks all the objects
+  markEpoch ^= MARK;
+
+  for (auto *b : oldBlocks) {
+    std::memset(b->lines, 0, sizeof(b->lines));
+  }
+
+  auto visit = [&](void *slot) { mark(slot); };
+
+  for (auto &r : roots) {
+    forEachRef(r.object, r.layout, r.size, visit);
+  }
+
+  // Old objects don't move, so the derived pointers stay the same
+  for (const auto &frame : frames) {
+    walkStack(frame, [&](void *base, void * /*derived*/) { mark(base); });
+  }
+
+  while (!worklist.empty()) {
+    auto *h = worklist.back();
+    worklist.pop_back();
+    forEachRef(h, visit);
+  }
+
+  sweep();
+  majorThreshold = std::max(MIN_MAJOR_THRESHOLD, 2 * getOldBytes());
+  stats.numOfMajorCollections++;
+};
+
+void Heap::sweep() {
+  std::vector<Block *> live;
+  recyclable.clear();
+
+  for (auto *b : oldBlocks) {
+    auto used = std::count(std::begin(b->lines), std::end(b->lines), 1);
+
+    if (used == 0) {
+      releaseBlock(b);
+      continue;
+    }
+
+    live.push_back(b);
+    if (static_cast<size_t>(used) < LINES_PER_BLOCK) {
+      recyclable.push_back(b);
+    }
+  }
+
+  oldBlocks      = std::move(live);
+  nextRecyclable = 0;
+  oldBlock       = nullptr;
+  oldCursor      = nullptr;
+  oldLimit       = nullptr;
+
+  llvm::erase_if(largeObjects, [&](Header *h) {
+    if ((h->flags & MARK) == markEpoch) {
+      return false;
+    }
+
+    largeObjectSet.erase(getPayload(h));
+    largeObjectBytes -= h->size;
+    std::free(h);
+    return true;
+  });
+};
+
+bool Heap::isStopped(const Mutator &self) const {
+  return std::all_of(mutators.begin(), mutators.end(), [&](const auto *m) {
+    return m == &self || m->state != Mutator::State::Running;
+  });
+};
+
+/// Stop the current thread at the given \p frame until the collection of
+/// another thread is over
+void Heap::park(Mutator &self, Frame frame,
+                std::unique_lock<std::mutex> &guard) {
+  // The collector releases the whole nursery, so each thread gives up its
+  // own buffer
+  *self.tlab = TLAB{};
+  self.frame = frame;
+  self.state = Mutator::State::Parked;
+  stopped.notify_all();
+
+  resumed.wait(guard, [&] { return !stopping; });
+
+  self.frame = Frame{};
+  self.state = Mutator::State::Running;
+};
+
+void Heap::collect(Mutator &self, bool forceMajor, Frame frame) {
+  std::unique_lock<std::mutex> guard(lock);
+
+  if (stopping) {
+    park(self, frame, guard);
+
+    // The nursery is empty now, so only a major collection is left to do
+    if (!forceMajor) {
+      return;
+    }
+
+    while (stopping) {
+      park(self, frame, guard);
+    }
+  }
+
+  // Stop the world. The other threads notice the request at their next
+  // safepoint and park there.
+  stopping = true;
+  collectionRequested.store(true, std::memory_order_relaxed);
+  *self.tlab = TLAB{};
+  stopped.wait(guard, [&] { return isStopped(self); });
+
+  auto start = std::chrono::steady_clock::now();
+
+  llvm::SmallVector<Frame, 8> frames{frame};
+  for (const auto *m : mutators) {
+    if (m->state == Mutator::State::Parked) {
+      frames.push_back(m->frame);
+    }
+  }
+
+  minor(frames);
+
+  if (forceMajor || getOldBytes() > majorThreshold) {
+    major(frames);
+  }
+
+  stopping = false;
+  collectionRequested.store(false, std::memory_order_relaxed);
+  resumed.notify_all();
+
+  auto pause = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - start)
+          .count());
+
+  stats.totalPauseNs += pause;
+  stats.maxPauseNs = std::max(stats.maxPauseNs, pause);
+};
+
+GCStats Heap::getStats() {
+  std::lock_guard<std::mutex> guard(lock);
+
+  auto ret     = stats;
+  ret.oldBytes = getOldBytes();
+  return ret;
+};
+
+// ============================================================================
+// Public API
+// ============================================================================
+/// Return the mutator of the current thread. Each thread registers on its
+/// first use of the heap and stays registered until it exits.
+static Mutator &getMutator() {
+  thread_local struct Registration {
+    Mutator mutator{&currentTLAB};
+
+    Registration() { getHeap().addMutator(&mutator); };
+    ~Registration() { getHeap().removeMutator(&mutator); };
+  } registration;
+
+  return registration.mutator;
+};
+
+void *allocateSlow(size_t size, Layout layout) {
+  getMutator();
+  return getHeap().allocateSlow(size, layout);
+};
+
+void writeBarrier(const void *object) {
+  auto *h = getHeader(reinterpret_cast<uint64_t>(object));
+
+  // Young objects are always scanned on the next minor collection
+  if ((h->flags & (OLD | REMEMBERED)) == OLD) {
+    getHeap().remember(h);
+  }
+};
+
+void collect(bool major) { getHeap().collect(getMutator(), major, Frame{}); };
+
+NativeScope::NativeScope() { getHeap().leaveSerene(getMutator()); };
+
+NativeScope::~NativeScope() { getHeap().enterSerene(getMutator()); };
+
+JITCall::JITCall() { getMutator().numOfJITCalls++; };
+
+JITCall::~JITCall() { getMutator().numOfJITCalls--; };
+
+void addRoot(void *object, Layout layout, size_t size) {
+  getHeap().addRoot(object, layout, size);
+};
+
+void removeRoot(void *object) { getHeap().removeRoot(object); };
+
+void registerStackMaps(llvm::ArrayRef<uint8_t> section) {
+  getHeap().registerStackMaps(section);
+};
+
+GCStats getGCStats() { return getHeap().getStats(); };
+
+} // namespace serene::runtime
+
+extern "C" serene::runtime::TLAB *__serene_gc_get_tlab() {
+  return &serene::runtime::currentTLAB;
+};
+
+extern "C" void *__serene_gc_allocate(uint64_t size, uint8_t layout) {
+  return serene::runtime::allocateSlow(
+      size, static_cast<serene::runtime::Layout>(layout));
+};
+
+extern "C" LLVM_ATTRIBUTE_NOINLINE void __serene_gc_safepoint() {
+  using serene::runtime::Frame;
+
+  auto &heap = serene::runtime::getHeap();
+
+  if (!heap.isCollectionRequested()) {
+    return;
+  }
+
+  auto &self = serene::runtime::getMutator();
+
+  // The walk stops at the first frame out of the JIT'd code, so it would
+  // miss the JIT'd frames under a runtime frame and move the values in the
+  // locals of that runtime frame. The collection waits for a safepoint
+  // with no runtime frame in between.
+  if (self.numOfJITCalls > 1) {
+    return;
+  }
+
+#if defined(__x86_64__)
+  // Taking the frame address keeps the frame pointer of this function, so
+  // the frame of the JIT'd caller is right above it
+  const auto *fp =
+      static_cast<const uintptr_t *>(__builtin_frame_address(0));
+  heap.collect(self, false,
+               Frame{fp[1], reinterpret_cast<uintptr_t>(fp + 2), fp[0]});
+#else
+  // There's no stack walk to update the JIT'd frames on the other targets
+  if (self.numOfJITCalls != 0) {
+    llvm::report_fatal_error("The GC safepoints of the JIT'd code are only "
+                             "supported on x86-64");
+  }
+
+  heap.collect(self, false, Frame{});
+#endif
+};
@@ -0,0 +1,173 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Commentary:
+ * A precise and generational collector for the runtime.
+ *
+ * - New objects are bump allocated in the nursery, a set of 32KB blocks.
+ *   Each thread allocates in its own block (look at `TLAB` in `heap.h`).
+ * - A minor collection copies the live objects of the nursery to the old
+ *   generation and releases the whole nursery. Its roots are the registered
+ *   roots, the old objects that changed since the last collection (look at
+ *   `writeBarrier`) and the stack of the JIT'd code.
+ * - The old generation is mark-region (Immix without the defragmentation).
+ *   Its blocks are split into 256 byte lines. A major collection marks the
+ *   live objects and the lines that they use. The free lines of a block are
+ *   the holes that the next promotions fill in with a bump pointer and the
+ *   blocks without any live line are reused. Old objects never move.
+ * - Objects bigger than 8KB go directly to the old generation and each one
+ *   is allocated on its own.
+ *
+ * The collector only runs at safepoints, i.e. `collect` and the safepoints
+ * of the JIT'd code. Allocating never collects, a full nursery just asks
+ * for a collection at the next safepoint. So the runtime functions can keep
+ * the new objects in their locals without rooting them.
+ *
+ * The JIT'd code uses LLVM statepoints (look at `jit/gc.h`) and keeps the
+ * values as `ptr addrspace(1)`. The JIT registers the stack maps of its
+ * objects via `registerStackMaps` and the collector walks the frames of
+ * the JIT'd code from the safepoint to update the references in them. The
+ * walk follows the frame pointers and is only implemented for x86-64. It
+ * stops at the first frame out of the JIT'd code, so the calls from the
+ * C++ code into the JIT'd code are marked with `JITCall` and a safepoint
+ * doesn't collect while there's a runtime frame between the JIT'd frames.
+ *
+ * The collector stops the world. Each thread registers on its first use of
+ * the heap and the collecting thread waits for all the other registered
+ * threads to park at a safepoint, or to be out of the Serene code (look at
+ * `NativeScope`), before it starts. So a thread that runs a long loop of
+ * C++ code with the runtime values holds the collections of the others
+ * off until it reaches a safepoint. Each thread gives up its own
+ * allocation buffer as it parks.
+ *
+ * If Serene is built with `SERENE_WITH_BDWGC`, the same interface is backed
+ * by the conservative Boehm GC instead.
+ */
+
+#ifndef RUNTIME_GC_H
+#define RUNTIME_GC_H
+
+#include "runtime/heap.h"
+
+#include <llvm/ADT/ArrayRef.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace serene::runtime {
+
+struct GCStats {
+  uint64_t numOfMinorCollections = 0;
+  uint64_t numOfMajorCollections = 0;
+  /// The bytes that the minor collections copied to the old generation
+  uint64_t promotedBytes = 0;
+  /// The current size of the old generation, including the large objects
+  uint64_t oldBytes = 0;
+  uint64_t totalPauseNs = 0;
+  uint64_t maxPauseNs   = 0;
+};
+
+/// Collect the nursery and also the old generation if it's \p major or if
+/// the old generation has grown enough since the last major collection.
+///
+/// It doesn't look at the stack, so every live object has to be reachable
+/// from the registered roots. Use it when there's no JIT'd code on the
+/// stack.
+void collect(bool major = false);
+
+/// Register the \p size bytes at \p object with the given \p layout as a
+/// root. The collector updates the references in it when it moves the
+/// objects.
+void addRoot(void *object, Layout layout, size_t size);
+void removeRoot(void *object);
+
+/// Keep a runtime value of type `T` alive in the C++ code, e.g.
+/// \code
+/// Root<Vector> v(makeVector(elements));
+/// collect();
+/// nth(v.get(), 0);
+/// \endcode
+template <typename T>
+class Root {
+  T value;
+
+public:
+  explicit Root(T value) : value(value) {
+    addRoot(&this->value, LayoutOf<T>::value, sizeof(T));
+  };
+
+  Root(const Root &)            = delete;
+  Root &operator=(const Root &) = delete;
+
+  ~Root() { removeRoot(&value); };
+
+  T &get() { return value; };
+  const T &get() const { return value; };
+
+  T *operator->() { return &value; };
+};
+
+/// Mark the current thread as out of the Serene code for the lifetime of the
+/// scope, e.g. while it blocks or waits for the other threads. The other
+/// threads can collect in the meantime without waiting for it, so it can't
+/// touch any runtime value that is not rooted and it can't have JIT'd
+/// frames on its stack.
+class NativeScope {
+public:
+  NativeScope();
+  ~NativeScope();
+
+  NativeScope(const NativeScope &)            = delete;
+  NativeScope &operator=(const NativeScope &) = delete;
+};
+
+/// Mark a call from the C++ code into the JIT'd code for the lifetime of
+/// the object. Just like around `collect`, the caller has to root the
+/// values that it keeps across the call.
+class JITCall {
+public:
+  JITCall();
+  ~JITCall();
+
+  JITCall(const JITCall &)            = delete;
+  JITCall &operator=(const JITCall &) = delete;
+};
+
+/// Register the `.llvm_stackmaps` section of a JIT'd object. It has to be
+/// relocated already.
+void registerStackMaps(llvm::ArrayRef<uint8_t> section);
+
+GCStats getGCStats();
+
+} // namespace serene::runtime
+
+/// The safepoint of the JIT'd code. It collects, or parks the thread while
+/// another one collects, if a collection is requested. The JIT'd code has
+/// to call it as a statepoint.
+extern "C" void __serene_gc_safepoint();
+
+/// Return the allocation buffer of the current thread. The JIT'd code
+/// calls it once per function and bumps the buffer inline.
+extern "C" serene::runtime::TLAB *__serene_gc_get_tlab();
+
+/// The slow path of the allocations of the JIT'd code. Just like
+/// `allocateSlow`, the \p size includes the header.
+extern "C" void *__serene_gc_allocate(uint64_t size, uint8_t layout);
+
+#endif
@@ -0,0 +1,235 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Commentary:
+ * The entry point of the runtime for allocating objects. All the runtime
+ * data structures allocate through `allocate` and never free anything
+ * themselves, the memory belongs to the GC (look at `gc.h`).
+ *
+ * The collector is precise, so each object has a `Layout` that tells it
+ * which words of the object are references. A reference is a word that is
+ * either an immediate `Value`, `nullptr`, a pointer to the start of a GC
+ * object or a pointer to memory out of the GC heap (e.g. static data).
+ * Pointers into the middle of a GC object are not allowed.
+ *
+ * Objects never change after their creation, except the nodes of the
+ * transients and the chunks of the lists on `cons`. Changing an object in
+ * place has to go through `writeBarrier`, so the minor collections can find
+ * the old objects that point to the young ones.
+ *
+ * Each thread allocates from its own thread local allocation buffer
+ * (`TLAB`), a nursery block that only that thread bumps into. So the fast
+ * path of `allocate` is inline and doesn't take any lock, only refilling
+ * the buffer goes to the collector. The JIT'd code does the same bump
+ * inline (look at `emitAllocation` in `jit/gc.h`).
+ */
+
+#ifndef RUNTIME_HEAP_H
+#define RUNTIME_HEAP_H
+
+#include "serene/config.h"
+#include "serene/layout.h"
+#include "types.h"
+
+#include <llvm/Support/Compiler.h>
+#include <llvm/Support/MathExtras.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace serene::runtime {
+
+/// Which words of an object are references
+enum class Layout : uint8_t {
+  /// No references at all, e.g. the bytes of a string or a `Number`
+  Raw = 0,
+  /// Every word is a reference
+  Values,
+  Object,
+  Pair,
+  /// It depends on the kind of the string, look at `forEachRef`
+  String,
+  List,
+  /// `next` and the elements in `[front, capacity)`
+  ListChunk,
+  Vector,
+  VectorNode,
+  Map,
+  /// The keys, values and child nodes, but not the hashes
+  MapNode,
+};
+
+/// The layout of the runtime type `T`
+template <typename T>
+struct LayoutOf;
+
+template <>
+struct LayoutOf<Value> {
+  static constexpr Layout value = Layout::Values;
+};
+
+template <typename T>
+struct LayoutOf<T *> {
+  static constexpr Layout value = Layout::Values;
+};
+
+template <>
+struct LayoutOf<Object> {
+  static constexpr Layout value = Layout::Object;
+};
+
+template <>
+struct LayoutOf<Pair> {
+  static constexpr Layout value = Layout::Pair;
+};
+
+template <>
+struct LayoutOf<String> {
+  static constexpr Layout value = Layout::String;
+};
+
+template <>
+struct LayoutOf<Rope> {
+  static constexpr Layout value = Layout::String;
+};
+
+template <>
+struct LayoutOf<Number> {
+  static constexpr Layout value = Layout::Raw;
+};
+
+template <>
+struct LayoutOf<BigInt> {
+  static constexpr Layout value = Layout::Raw;
+};
+
+template <>
+struct LayoutOf<List> {
+  static constexpr Layout value = Layout::List;
+};
+
+template <>
+struct LayoutOf<ListChunk> {
+  static constexpr Layout value = Layout::ListChunk;
+};
+
+template <>
+struct LayoutOf<Vector> {
+  static constexpr Layout value = Layout::Vector;
+};
+
+template <>
+struct LayoutOf<VectorNode> {
+  static constexpr Layout value = Layout::VectorNode;
+};
+
+template <>
+struct LayoutOf<Map> {
+  static constexpr Layout value = Layout::Map;
+};
+
+template <>
+struct LayoutOf<MapNode> {
+  static constexpr Layout value = Layout::MapNode;
+};
+
+/// Each GC object starts with a header right before the pointer that
+/// `allocate` returns.
+struct Header {
+  /// The size of the object including the header in bytes
+  uint32_t size;
+  Layout layout;
+  uint8_t flags;
+  uint16_t reserved;
+};
+
+static_assert(sizeof(Header) == SERENE_GC_HEADER_SIZE,
+              "The objects have to stay 8 bytes aligned");
+static_assert(offsetof(Header, size) == SERENE_GC_HEADER_SIZE_OFFSET);
+static_assert(offsetof(Header, layout) == SERENE_GC_HEADER_LAYOUT_OFFSET);
+static_assert(offsetof(Header, flags) == SERENE_GC_HEADER_FLAGS_OFFSET);
+
+/// Objects bigger than this (including the header) bypass the nursery
+constexpr size_t LARGE_OBJECT_SIZE = SERENE_GC_LARGE_OBJECT_SIZE;
+
+/// The thread local allocation buffer. Objects are bump allocated in
+/// `[cursor, limit)` and the collector resets both to `nullptr` once it
+/// releases the nursery.
+struct TLAB {
+  char *cursor = nullptr;
+  char *limit  = nullptr;
+};
+
+static_assert(offsetof(TLAB, cursor) == SERENE_TLAB_CURSOR_OFFSET);
+static_assert(offsetof(TLAB, limit) == SERENE_TLAB_LIMIT_OFFSET);
+
+/// The allocation buffer of the current thread
+inline thread_local TLAB currentTLAB;
+
+#ifdef SERENE_WITH_BDWGC
+void *allocate(size_t size, Layout layout);
+#else
+/// The slow path of `allocate`. It refills the allocation buffer of the
+/// current thread or allocates a large object. The \p size includes the
+/// header and it's already aligned.
+void *allocateSlow(size_t size, Layout layout);
+
+/// Allocate \p size bytes for a runtime object with the given \p layout.
+/// The memory is at least 8 bytes aligned, so the pointer can be a tagged
+/// `Value`. It never collects, a full nursery only requests a collection
+/// at the next safepoint.
+inline void *allocate(size_t size, Layout layout) {
+  // Each object needs at least one word for the forwarding pointer
+  size = std::max(llvm::alignTo(size + sizeof(Header), sizeof(uint64_t)),
+                  2 * sizeof(uint64_t));
+
+  auto &tlab = currentTLAB;
+
+  if (LLVM_UNLIKELY(size > LARGE_OBJECT_SIZE ||
+                    static_cast<size_t>(tlab.limit - tlab.cursor) < size)) {
+    return allocateSlow(size, layout);
+  }
+
+  auto *h = reinterpret_cast<Header *>(tlab.cursor);
+  tlab.cursor += size;
+  *h = Header{static_cast<uint32_t>(size), layout, 0, 0};
+  return h + 1;
+};
+#endif
+
+/// Allocate an object of type `T` with \p extra bytes after it for its
+/// trailing elements.
+template <typename T>
+T *allocate(size_t extra = 0) {
+  return static_cast<T *>(allocate(sizeof(T) + extra, LayoutOf<T>::value));
+};
+
+/// Just like the other one, but for the types without a `LayoutOf`
+template <typename T>
+T *allocate(Layout layout, size_t extra = 0) {
+  return static_cast<T *>(allocate(sizeof(T) + extra, layout));
+};
+
+/// Record that the given GC \p object is about to change in place
+void writeBarrier(const void *object);
+
+} // namespace serene::runtime
+
+#endif
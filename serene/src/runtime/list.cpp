@@ -0,0 +1,126 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "runtime/list.h"
+
+#include "runtime/heap.h"
+
+#include <llvm/Support/MathExtras.h>
+
+#include <cassert>
+
+namespace serene::runtime {
+
+/// Return the capacity of a new chunk for a list of \p len elements
+static uint32_t getChunkCapacity(uint32_t len) {
+  return std::clamp<uint32_t>(static_cast<uint32_t>(llvm::PowerOf2Ceil(len)),
+                              LIST_CHUNK_MIN_SIZE, LIST_CHUNK_MAX_SIZE);
+};
+
+static ListChunk *allocateChunk(uint32_t capacity) {
+  auto *chunk       = allocate<ListChunk>(capacity * sizeof(Value));
+  chunk->next       = nullptr;
+  chunk->nextOffset = 0;
+  chunk->front      = capacity;
+  chunk->capacity   = capacity;
+  return chunk;
+};
+
+List makeList(llvm::ArrayRef<Value> elements) {
+  ListBuilder b(static_cast<uint32_t>(elements.size()));
+
+  for (auto v : elements) {
+    b.push(v);
+  }
+
+  return b.build();
+};
+
+List cons(Value v, const List &l) {
+  if (!isEmpty(l) && l.offset > 0) {
+    auto *chunk   = const_cast<ListChunk *>(l.chunk);
+    auto expected = l.offset;
+
+    // Only one list can claim the slot before the front of the chunk
+    if (__atomic_compare_exchange_n(&chunk->front, &expected, l.offset - 1,
+                                    false, __ATOMIC_ACQ_REL,
+                                    __ATOMIC_ACQUIRE)) {
+      writeBarrier(chunk);
+      chunk->elements[l.offset - 1] = v;
+      return List{chunk, l.offset - 1, l.len + 1};
+    }
+  }
+
+  auto *chunk       = allocateChunk(getChunkCapacity(l.len + 1));
+  auto offset       = chunk->capacity - 1;
+  chunk->next       = l.chunk;
+  chunk->nextOffset = l.offset;
+  chunk->front      = offset;
+
+  chunk->elements[offset] = v;
+  return List{chunk, offset, l.len + 1};
+};
+
+List rest(const List &l) {
+  if (l.len <= 1) {
+    return emptyList();
+  }
+
+  if (l.offset + 1 < l.chunk->capacity) {
+    return List{l.chunk, l.offset + 1, l.len - 1};
+  }
+
+  return List{l.chunk->next, l.chunk->nextOffset, l.len - 1};
+};
+
+// ============================================================================
+// ListBuilder
+// ============================================================================
+ListBuilder::ListBuilder(uint32_t len) : list(emptyList()) {
+  if (len == 0) {
+    return;
+  }
+
+  // All the chunks are full except the first one
+  auto size = len % LIST_CHUNK_MAX_SIZE;
+  size      = size == 0 ? LIST_CHUNK_MAX_SIZE : size;
+
+  current = newChunk(getChunkCapacity(size), size);
+  list    = List{current, current->front, len};
+};
+
+ListChunk *ListBuilder::newChunk(uint32_t capacity, uint32_t size) {
+  auto *chunk  = allocateChunk(capacity);
+  chunk->front = capacity - size;
+  pos          = chunk->front;
+  return chunk;
+};
+
+void ListBuilder::push(Value v) {
+  assert(current != nullptr && "The list is full already");
+
+  if (pos == current->capacity) {
+    auto *chunk   = newChunk(LIST_CHUNK_MAX_SIZE, LIST_CHUNK_MAX_SIZE);
+    current->next = chunk;
+    current       = chunk;
+  }
+
+  current->elements[pos++] = v;
+};
+
+} // namespace serene::runtime
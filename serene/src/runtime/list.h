@@ -0,0 +1,134 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Commentary:
+ * The operations on the persistent `List` of the runtime (look at `types.h`
+ * for the layout). A list is an unrolled linked list of `ListChunk`s:
+ *
+ * - `cons` either claims the free slot before the first element of the
+ *   chunk (if no other list claimed it already) or starts a new chunk. New
+ *   chunks get bigger as the list grows, from 8 up to 32 elements.
+ * - `rest` just moves the offset forward, the chunks never change.
+ * - Iteration goes over the contiguous spans of the chunks, so `map` and
+ *   `reduce` are mostly sequential reads instead of a pointer chase per
+ *   element.
+ */
+
+#ifndef RUNTIME_LIST_H
+#define RUNTIME_LIST_H
+
+#include "types.h"
+
+#include <llvm/ADT/ArrayRef.h>
+
+#include <algorithm>
+#include <cstdint>
+
+namespace serene::runtime {
+
+constexpr uint32_t LIST_CHUNK_MIN_SIZE = 8;
+constexpr uint32_t LIST_CHUNK_MAX_SIZE = 32;
+
+inline List emptyList() { return List{nullptr, 0, 0}; };
+
+inline bool isEmpty(const List &l) { return l.len == 0; };
+
+/// Create a list with the given \p elements in the same order
+List makeList(llvm::ArrayRef<Value> elements);
+
+/// Return a new list with \p v as the first element and \p l as the rest
+List cons(Value v, const List &l);
+
+/// Return the first element of \p l or `nil` if it's empty
+inline Value first(const List &l) {
+  return isEmpty(l) ? SERENE_NIL : l.chunk->elements[l.offset];
+};
+
+/// Return the list of all the elements of \p l except the first one
+List rest(const List &l);
+
+/// Call \p fn with each contiguous span of the elements of \p l in order
+template <typename Fn>
+void forEachSpan(const List &l, Fn fn) {
+  const auto *chunk = l.chunk;
+  auto offset       = l.offset;
+  auto remaining    = l.len;
+
+  while (remaining > 0) {
+    auto n = std::min(chunk->capacity - offset, remaining);
+    fn(llvm::ArrayRef<Value>(&chunk->elements[offset], n));
+
+    remaining -= n;
+    offset = chunk->nextOffset;
+    chunk  = chunk->next;
+  }
+};
+
+/// Builds a list of a known length from the first element to the last one.
+/// The chunks are packed, only the first one might have free slots for the
+/// future `cons`es.
+class ListBuilder {
+  List list;
+
+  ListChunk *current = nullptr;
+  uint32_t pos       = 0;
+
+  ListChunk *newChunk(uint32_t capacity, uint32_t size);
+
+public:
+  explicit ListBuilder(uint32_t len);
+
+  /// Add \p v to the end of the list. Only `len` elements can be added.
+  void push(Value v);
+
+  /// Return the list. All the `len` elements have to be pushed already.
+  List build() const { return list; };
+};
+
+/// Return a new list of the result of calling \p fn on each element of \p l
+template <typename Fn>
+List map(const List &l, Fn fn) {
+  ListBuilder b(l.len);
+
+  forEachSpan(l, [&](llvm::ArrayRef<Value> span) {
+    for (auto v : span) {
+      b.push(fn(v));
+    }
+  });
+
+  return b.build();
+};
+
+/// Fold the elements of \p l from the first one into \p init via \p fn
+template <typename Fn>
+Value reduce(const List &l, Value init, Fn fn) {
+  auto acc = init;
+
+  forEachSpan(l, [&](llvm::ArrayRef<Value> span) {
+    for (auto v : span) {
+      acc = fn(acc, v);
+    }
+  });
+
+  return acc;
+};
+
+} // namespace serene::runtime
+
+#endif
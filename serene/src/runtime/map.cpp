@@ -0,0 +1,527 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "runtime/map.h"
+
+#include "runtime/heap.h"
+#include "runtime/string.h"
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/xxhash.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cassert>
+
+namespace serene::runtime {
+
+/// Persistent nodes don't belong to any transient
+constexpr uint64_t NO_OWNER = 0;
+
+constexpr unsigned MAP_BITS = 5;
+constexpr unsigned MAP_MASK = (1U << MAP_BITS) - 1;
+/// The nodes at this shift are collision nodes. They keep the entries with
+/// the same 64 bit hash in a plain array (up to 255 of them).
+constexpr unsigned MAX_SHIFT = 64;
+
+static std::atomic<uint64_t> lastOwner{NO_OWNER};
+
+// Node layout ================================================================
+template <typename Node>
+static auto *getHashes(Node *node) {
+  return node->slots;
+};
+
+template <typename Node>
+static auto *getKeys(Node *node) {
+  return node->slots + node->entryCapacity;
+};
+
+template <typename Node>
+static auto *getValues(Node *node) {
+  return node->slots + (2 * node->entryCapacity);
+};
+
+static const MapNode **getNodes(MapNode *node) {
+  return reinterpret_cast<const MapNode **>(node->slots +
+                                            (3 * node->entryCapacity));
+};
+
+static const MapNode *const *getNodes(const MapNode *node) {
+  return reinterpret_cast<const MapNode *const *>(node->slots +
+                                                  (3 * node->entryCapacity));
+};
+
+static uint32_t getBit(uint64_t hash, unsigned shift) {
+  return 1U << ((hash >> shift) & MAP_MASK);
+};
+
+/// Return the index of the given \p bit in the array of the \p bitmap
+static unsigned getIndex(uint32_t bitmap, uint32_t bit) {
+  return static_cast<unsigned>(std::popcount(bitmap & (bit - 1)));
+};
+
+/// Return the capacity of a node that needs \p n slots. Nodes of the
+/// transients get extra room to grow in place.
+static unsigned getCapacity(uint64_t owner, unsigned n) {
+  assert(n <= UINT8_MAX && "Too many entries in a node");
+
+  if (owner == NO_OWNER || n == 0) {
+    return n;
+  }
+
+  return std::min<unsigned>(std::bit_ceil(n), UINT8_MAX);
+};
+
+static MapNode *newNode(uint64_t owner, unsigned entryCapacity,
+                        unsigned nodeCapacity) {
+  auto *node = allocate<MapNode>(((3 * entryCapacity) + nodeCapacity) *
+                                 sizeof(uint64_t));
+  node->owner         = owner;
+  node->dataMap       = 0;
+  node->nodeMap       = 0;
+  node->numOfEntries  = 0;
+  node->numOfNodes    = 0;
+  node->entryCapacity = static_cast<uint8_t>(entryCapacity);
+  node->nodeCapacity  = static_cast<uint8_t>(nodeCapacity);
+  node->reserved      = 0;
+  return node;
+};
+
+/// Return a version of \p node that \p owner can change in place and has
+/// room for \p numOfEntries entries and \p numOfNodes child nodes. It's the
+/// node itself if the owner already owns it and it's big enough.
+static MapNode *getEditable(const MapNode *node, uint64_t owner,
+                            unsigned numOfEntries, unsigned numOfNodes) {
+  if (owner != NO_OWNER && node->owner == owner &&
+      node->entryCapacity >= numOfEntries && node->nodeCapacity >= numOfNodes) {
+    writeBarrier(node);
+    return const_cast<MapNode *>(node);
+  }
+
+  auto *copy = newNode(
+      owner, getCapacity(owner, std::max<unsigned>(numOfEntries,
+                                                   node->numOfEntries)),
+      getCapacity(owner, std::max<unsigned>(numOfNodes, node->numOfNodes)));
+
+  copy->dataMap      = node->dataMap;
+  copy->nodeMap      = node->nodeMap;
+  copy->numOfEntries = node->numOfEntries;
+  copy->numOfNodes   = node->numOfNodes;
+
+  std::copy_n(getHashes(node), node->numOfEntries, getHashes(copy));
+  std::copy_n(getKeys(node), node->numOfEntries, getKeys(copy));
+  std::copy_n(getValues(node), node->numOfEntries, getValues(copy));
+  std::copy_n(getNodes(node), node->numOfNodes, getNodes(copy));
+  return copy;
+};
+
+// The following functions expect a node with enough room ==================
+static void insertEntry(MapNode *node, unsigned i, uint64_t hash, Value key,
+                        Value value) {
+  auto n = node->numOfEntries;
+
+  std::copy_backward(getHashes(node) + i, getHashes(node) + n,
+                     getHashes(node) + n + 1);
+  std::copy_backward(getKeys(node) + i, getKeys(node) + n,
+                     getKeys(node) + n + 1);
+  std::copy_backward(getValues(node) + i, getValues(node) + n,
+                     getValues(node) + n + 1);
+
+  getHashes(node)[i] = hash;
+  getKeys(node)[i]   = key;
+  getValues(node)[i] = value;
+  node->numOfEntries++;
+};
+
+static void removeEntry(MapNode *node, unsigned i) {
+  auto n = node->numOfEntries;
+
+  std::copy(getHashes(node) + i + 1, getHashes(node) + n, getHashes(node) + i);
+  std::copy(getKeys(node) + i + 1, getKeys(node) + n, getKeys(node) + i);
+  std::copy(getValues(node) + i + 1, getValues(node) + n, getValues(node) + i);
+  node->numOfEntries--;
+};
+
+static void insertNode(MapNode *node, unsigned i, const MapNode *child) {
+  auto n = node->numOfNodes;
+
+  std::copy_backward(getNodes(node) + i, getNodes(node) + n,
+                     getNodes(node) + n + 1);
+  getNodes(node)[i] = child;
+  node->numOfNodes++;
+};
+
+static void removeNode(MapNode *node, unsigned i) {
+  auto n = node->numOfNodes;
+
+  std::copy(getNodes(node) + i + 1, getNodes(node) + n, getNodes(node) + i);
+  node->numOfNodes--;
+};
+
+// Trie operations ============================================================
+/// Create the subtrie for two entries with the same hash fragments till
+/// the given \p shift.
+static const MapNode *mergeEntries(uint64_t owner, unsigned shift,
+                                   uint64_t hash0, Value key0, Value value0,
+                                   uint64_t hash1, Value key1, Value value1) {
+  if (shift >= MAX_SHIFT) {
+    auto *node = newNode(owner, getCapacity(owner, 2), 0);
+    insertEntry(node, 0, hash0, key0, value0);
+    insertEntry(node, 1, hash1, key1, value1);
+    return node;
+  }
+
+  auto bit0 = getBit(hash0, shift);
+  auto bit1 = getBit(hash1, shift);
+
+  if (bit0 == bit1) {
+    auto *node    = newNode(owner, 0, getCapacity(owner, 1));
+    node->nodeMap = bit0;
+    insertNode(node, 0,
+               mergeEntries(owner, shift + MAP_BITS, hash0, key0, value0,
+                            hash1, key1, value1));
+    return node;
+  }
+
+  auto *node    = newNode(owner, getCapacity(owner, 2), 0);
+  node->dataMap = bit0 | bit1;
+
+  // Entries are ordered by their bits
+  if (bit0 > bit1) {
+    std::swap(hash0, hash1);
+    std::swap(key0, key1);
+    std::swap(value0, value1);
+  }
+
+  insertEntry(node, 0, hash0, key0, value0);
+  insertEntry(node, 1, hash1, key1, value1);
+  return node;
+};
+
+static const MapNode *setValue(const MapNode *node, uint64_t owner,
+                               unsigned i, Value value) {
+  if (getValues(node)[i] == value) {
+    return node;
+  }
+
+  auto *ret         = getEditable(node, owner, 0, 0);
+  getValues(ret)[i] = value;
+  return ret;
+};
+
+static const MapNode *assocIn(const MapNode *node, uint64_t owner,
+                              unsigned shift, uint64_t hash, Value key,
+                              Value value, bool &added) {
+  if (shift >= MAX_SHIFT) {
+    for (unsigned i = 0; i < node->numOfEntries; i++) {
+      if (equalValues(getKeys(node)[i], key)) {
+        return setValue(node, owner, i, value);
+      }
+    }
+
+    auto *ret = getEditable(node, owner, node->numOfEntries + 1, 0);
+    insertEntry(ret, ret->numOfEntries, hash, key, value);
+    added = true;
+    return ret;
+  }
+
+  auto bit = getBit(hash, shift);
+
+  if ((node->dataMap & bit) != 0) {
+    auto i = getIndex(node->dataMap, bit);
+
+    if (getHashes(node)[i] == hash && equalValues(getKeys(node)[i], key)) {
+      return setValue(node, owner, i, value);
+    }
+
+    // Two keys with the same hash fragment at this level go to a child
+    const auto *child =
+        mergeEntries(owner, shift + MAP_BITS, getHashes(node)[i],
+                     getKeys(node)[i], getValues(node)[i], hash, key, value);
+
+    auto *ret = getEditable(node, owner, node->numOfEntries,
+                            node->numOfNodes + 1);
+    removeEntry(ret, i);
+    ret->dataMap ^= bit;
+    insertNode(ret, getIndex(ret->nodeMap, bit), child);
+    ret->nodeMap |= bit;
+    added = true;
+    return ret;
+  }
+
+  if ((node->nodeMap & bit) != 0) {
+    auto i            = getIndex(node->nodeMap, bit);
+    const auto *child = getNodes(node)[i];
+    const auto *newChild =
+        assocIn(child, owner, shift + MAP_BITS, hash, key, value, added);
+
+    // The child might have changed in place
+    if (newChild == child) {
+      return node;
+    }
+
+    auto *ret        = getEditable(node, owner, 0, 0);
+    getNodes(ret)[i] = newChild;
+    return ret;
+  }
+
+  auto *ret =
+      getEditable(node, owner, node->numOfEntries + 1, node->numOfNodes);
+  insertEntry(ret, getIndex(ret->dataMap, bit), hash, key, value);
+  ret->dataMap |= bit;
+  added = true;
+  return ret;
+};
+
+static const MapNode *dissocIn(const MapNode *node, uint64_t owner,
+                               unsigned shift, uint64_t hash, Value key,
+                               bool &removed) {
+  if (shift >= MAX_SHIFT) {
+    for (unsigned i = 0; i < node->numOfEntries; i++) {
+      if (equalValues(getKeys(node)[i], key)) {
+        auto *ret = getEditable(node, owner, 0, 0);
+        removeEntry(ret, i);
+        removed = true;
+        return ret;
+      }
+    }
+
+    return node;
+  }
+
+  auto bit = getBit(hash, shift);
+
+  if ((node->dataMap & bit) != 0) {
+    auto i = getIndex(node->dataMap, bit);
+
+    if (getHashes(node)[i] != hash || !equalValues(getKeys(node)[i], key)) {
+      return node;
+    }
+
+    auto *ret = getEditable(node, owner, 0, 0);
+    removeEntry(ret, i);
+    ret->dataMap ^= bit;
+    removed = true;
+    return ret;
+  }
+
+  if ((node->nodeMap & bit) == 0) {
+    return node;
+  }
+
+  auto i            = getIndex(node->nodeMap, bit);
+  const auto *child = getNodes(node)[i];
+  const auto *newChild =
+      dissocIn(child, owner, shift + MAP_BITS, hash, key, removed);
+
+  if (!removed) {
+    return node;
+  }
+
+  // Keep the trie canonical, a child with a single entry goes back to the
+  // parent.
+  if (newChild->numOfNodes == 0 && newChild->numOfEntries == 1) {
+    auto *ret =
+        getEditable(node, owner, node->numOfEntries + 1, node->numOfNodes);
+    removeNode(ret, i);
+    ret->nodeMap ^= bit;
+    insertEntry(ret, getIndex(ret->dataMap, bit), getHashes(newChild)[0],
+                getKeys(newChild)[0], getValues(newChild)[0]);
+    ret->dataMap |= bit;
+    return ret;
+  }
+
+  if (newChild == child) {
+    return node;
+  }
+
+  auto *ret        = getEditable(node, owner, 0, 0);
+  getNodes(ret)[i] = newChild;
+  return ret;
+};
+
+// ============================================================================
+// Public API
+// ============================================================================
+/// Return the limbs of the given \p b as bytes
+static llvm::StringRef getLimbBytes(const BigInt *b) {
+  return llvm::StringRef(reinterpret_cast<const char *>(b->limbs),
+                         b->len * sizeof(uint64_t));
+};
+
+uint64_t hashValue(Value v) {
+  if (isObject(v)) {
+    const auto *o = getObject(v);
+
+    switch (getType(o->type)->id) {
+    case TypeID::STRING:
+      return llvm::xxHash64(getBytes(static_cast<const String *>(o->data)));
+
+    case TypeID::NUMBER:
+      // The same int might be in different boxes, so mix the int instead
+      v = static_cast<Value>(static_cast<const Number *>(o->data)->data);
+      break;
+
+    case TypeID::BIGINT: {
+      const auto *b = static_cast<const BigInt *>(o->data);
+      auto hash     = llvm::xxHash64(getLimbBytes(b));
+      return b->negative != 0 ? ~hash : hash;
+    }
+
+    default:
+      break;
+    }
+  }
+
+  // The low bits of the immediates and the pointers are mostly the same, so
+  // mix all the bits together (the finalizer of MurmurHash3)
+  v ^= v >> 33;
+  v *= 0xff51afd7ed558ccdULL;
+  v ^= v >> 33;
+  v *= 0xc4ceb9fe1a85ec53ULL;
+  v ^= v >> 33;
+  return v;
+};
+
+bool equalValues(Value a, Value b) {
+  if (a == b) {
+    return true;
+  }
+
+  if (!isObject(a) || !isObject(b)) {
+    return false;
+  }
+
+  const auto *x = getObject(a);
+  const auto *y = getObject(b);
+
+  // The ints are always in their smallest representation, so a boxed int
+  // is never equal to a fixnum or to an int of another type
+  if (x->type != y->type) {
+    return false;
+  }
+
+  switch (getType(x->type)->id) {
+  case TypeID::STRING: {
+    const auto *s1 = static_cast<const String *>(x->data);
+    const auto *s2 = static_cast<const String *>(y->data);
+    return s1->len == s2->len && getBytes(s1) == getBytes(s2);
+  }
+
+  case TypeID::NUMBER:
+    return static_cast<const Number *>(x->data)->data ==
+           static_cast<const Number *>(y->data)->data;
+
+  case TypeID::BIGINT: {
+    const auto *b1 = static_cast<const BigInt *>(x->data);
+    const auto *b2 = static_cast<const BigInt *>(y->data);
+    return (b1->negative != 0) == (b2->negative != 0) &&
+           getLimbBytes(b1) == getLimbBytes(b2);
+  }
+
+  default:
+    return false;
+  }
+};
+
+Map emptyMap() {
+  // All the empty maps can share the same root since it never changes.
+  // It's out of the GC heap, so it never moves.
+  static const MapNode empty{};
+  return Map{&empty, 0};
+};
+
+const Value *lookup(const Map &m, Value key) {
+  auto hash        = hashValue(key);
+  const auto *node = m.root;
+
+  for (unsigned shift = 0; shift < MAX_SHIFT; shift += MAP_BITS) {
+    auto bit = getBit(hash, shift);
+
+    if ((node->dataMap & bit) != 0) {
+      auto i = getIndex(node->dataMap, bit);
+
+      if (getHashes(node)[i] == hash && equalValues(getKeys(node)[i], key)) {
+        return &getValues(node)[i];
+      }
+
+      return nullptr;
+    }
+
+    if ((node->nodeMap & bit) == 0) {
+      return nullptr;
+    }
+
+    node = getNodes(node)[getIndex(node->nodeMap, bit)];
+  }
+
+  // A collision node
+  for (unsigned i = 0; i < node->numOfEntries; i++) {
+    if (equalValues(getKeys(node)[i], key)) {
+      return &getValues(node)[i];
+    }
+  }
+
+  return nullptr;
+};
+
+Map assoc(const Map &m, Value key, Value value) {
+  bool added = false;
+  const auto *root =
+      assocIn(m.root, NO_OWNER, 0, hashValue(key), key, value, added);
+  return Map{root, added ? m.len + 1 : m.len};
+};
+
+Map dissoc(const Map &m, Value key) {
+  bool removed = false;
+  const auto *root =
+      dissocIn(m.root, NO_OWNER, 0, hashValue(key), key, removed);
+  return Map{root, removed ? m.len - 1 : m.len};
+};
+
+// ============================================================================
+// TransientMap
+// ============================================================================
+TransientMap::TransientMap(const Map &m)
+    : m(m), owner(lastOwner.fetch_add(1, std::memory_order_relaxed) + 1){};
+
+void TransientMap::assoc(Value key, Value value) {
+  assert(owner != NO_OWNER && "The transient is already persistent");
+
+  bool added = false;
+  m.root     = assocIn(m.root, owner, 0, hashValue(key), key, value, added);
+  m.len += added ? 1 : 0;
+};
+
+void TransientMap::dissoc(Value key) {
+  assert(owner != NO_OWNER && "The transient is already persistent");
+
+  bool removed = false;
+  m.root       = dissocIn(m.root, owner, 0, hashValue(key), key, removed);
+  m.len -= removed ? 1 : 0;
+};
+
+Map TransientMap::persistent() {
+  // Nobody else has this id, so the nodes are immutable from now on
+  owner = NO_OWNER;
+  return m;
+};
+
+} // namespace serene::runtime
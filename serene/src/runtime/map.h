@@ -0,0 +1,119 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Commentary:
+ * The operations on the persistent `Map` of the runtime (look at `types.h`
+ * for the layout). It's a CHAMP (Compressed Hash-Array Mapped Prefix-tree):
+ *
+ * - Each level of the trie uses 5 bits of the 64 bit hash of the key.
+ * - A node has two bitmaps, one for the entries that are stored in the node
+ *   itself and one for the child nodes. The index of an entry (or a child)
+ *   is the number of the set bits before its bit (popcount).
+ * - The hashes, keys, values and children are separate arrays, so a lookup
+ *   compares the cached hashes first and only then the keys.
+ * - The trie is kept in the canonical form: removing an entry inlines a
+ *   child with a single entry back into its parent.
+ *
+ * Just like the vector, bulk insertions should go through a `TransientMap`
+ * that changes its own nodes in place and gives them room to grow.
+ */
+
+#ifndef RUNTIME_MAP_H
+#define RUNTIME_MAP_H
+
+#include "types.h"
+
+#include <cstdint>
+
+namespace serene::runtime {
+
+/// Return the hash of the given value. Strings and boxed ints are hashed by
+/// their content and all the other values by their identity.
+uint64_t hashValue(Value v);
+
+/// Return whether the given values are equal. Strings and boxed ints are
+/// compared by their content and all the other values by their identity.
+bool equalValues(Value a, Value b);
+
+Map emptyMap();
+
+inline uint32_t size(const Map &m) { return m.len; };
+
+/// Return a pointer to the value of the given \p key in \p m or `nullptr`
+/// if there is no such key. The value is owned by the map.
+const Value *lookup(const Map &m, Value key);
+
+/// Return a new map with the given \p key mapped to \p value
+Map assoc(const Map &m, Value key, Value value);
+
+/// Return a new map without the given \p key
+Map dissoc(const Map &m, Value key);
+
+/// Call \p fn with each key and value of \p m in the order of the trie
+template <typename Fn>
+void forEachEntry(const Map &m, Fn fn);
+
+/// A mutable version of a map that can only be used by one thread at a
+/// time. Look at `TransientVector` for the details.
+class TransientMap {
+  Map m;
+  uint64_t owner;
+
+public:
+  explicit TransientMap(const Map &m);
+
+  uint32_t size() const { return m.len; };
+
+  const Value *lookup(Value key) const { return runtime::lookup(m, key); };
+
+  void assoc(Value key, Value value);
+  void dissoc(Value key);
+
+  /// Return the persistent map and seal the nodes of the transient. The
+  /// transient can't be used anymore.
+  Map persistent();
+};
+
+// ============================================================================
+// Implementation details
+// ============================================================================
+template <typename Fn>
+void forEachEntry(const MapNode *node, Fn &fn) {
+  const auto *keys   = node->slots + node->entryCapacity;
+  const auto *values = keys + node->entryCapacity;
+  const auto *nodes =
+      reinterpret_cast<const MapNode *const *>(values + node->entryCapacity);
+
+  for (unsigned i = 0; i < node->numOfEntries; i++) {
+    fn(keys[i], values[i]);
+  }
+
+  for (unsigned i = 0; i < node->numOfNodes; i++) {
+    forEachEntry(nodes[i], fn);
+  }
+};
+
+template <typename Fn>
+void forEachEntry(const Map &m, Fn fn) {
+  forEachEntry(m.root, fn);
+};
+
+} // namespace serene::runtime
+
+#endif
@@ -0,0 +1,480 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "runtime/number.h"
+
+#include "runtime/heap.h"
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/ErrorHandling.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <new>
+
+namespace serene::runtime {
+
+using Limbs = llvm::SmallVector<uint64_t, 4>;
+
+// The full product of two limbs. `__extension__` keeps `-Wpedantic` quiet
+// about the non standard type.
+__extension__ using DoubleLimb = unsigned __int128;
+
+/// 10^19, the biggest power of ten in a limb
+constexpr uint64_t DECIMAL_BASE = 10000000000000000000ULL;
+constexpr size_t DECIMAL_DIGITS = 19;
+
+/// A signed int of any size as its sign and magnitude
+struct Signed {
+  bool negative = false;
+  /// The least significant limb first, without any zero at the end
+  Limbs mag;
+};
+
+// Magnitudes ================================================================
+static llvm::ArrayRef<uint64_t> trim(llvm::ArrayRef<uint64_t> a) {
+  while (!a.empty() && a.back() == 0) {
+    a = a.drop_back();
+  }
+  return a;
+};
+
+static void trim(Limbs &a) {
+  while (!a.empty() && a.back() == 0) {
+    a.pop_back();
+  }
+};
+
+/// Compare the trimmed magnitudes \p a and \p b
+static int compare(llvm::ArrayRef<uint64_t> a, llvm::ArrayRef<uint64_t> b) {
+  if (a.size() != b.size()) {
+    return a.size() < b.size() ? -1 : 1;
+  }
+
+  for (size_t i = a.size(); i-- > 0;) {
+    if (a[i] != b[i]) {
+      return a[i] < b[i] ? -1 : 1;
+    }
+  }
+
+  return 0;
+};
+
+/// Add \p b shifted left by \p shift limbs to \p acc. The sum has to fit in
+/// \p acc.
+static void addInto(llvm::MutableArrayRef<uint64_t> acc,
+                    llvm::ArrayRef<uint64_t> b, size_t shift) {
+  uint64_t carry = 0;
+  size_t i       = 0;
+
+  for (; i < b.size(); i++) {
+    auto sum = static_cast<DoubleLimb>(acc[shift + i]) + b[i] + carry;
+    acc[shift + i] = static_cast<uint64_t>(sum);
+    carry          = static_cast<uint64_t>(sum >> 64);
+  }
+
+  for (i += shift; carry != 0; i++) {
+    assert(i < acc.size() && "The sum doesn't fit");
+    acc[i] += carry;
+    carry = acc[i] == 0 ? 1 : 0;
+  }
+};
+
+static Limbs add(llvm::ArrayRef<uint64_t> a, llvm::ArrayRef<uint64_t> b) {
+  if (a.size() < b.size()) {
+    std::swap(a, b);
+  }
+
+  Limbs ret(a.begin(), a.end());
+  ret.push_back(0);
+  addInto(ret, b, 0);
+  trim(ret);
+  return ret;
+};
+
+/// Return `a - b`. \p a has to be bigger than or equal to \p b.
+static Limbs sub(llvm::ArrayRef<uint64_t> a, llvm::ArrayRef<uint64_t> b) {
+  Limbs ret(a.begin(), a.end());
+  uint64_t borrow = 0;
+
+  for (size_t i = 0; i < ret.size(); i++) {
+    auto x = ret[i];
+    auto y = i < b.size() ? b[i] : 0;
+
+    ret[i] = x - y - borrow;
+    borrow = (x < y || (x == y && borrow != 0)) ? 1 : 0;
+
+    if (i >= b.size() && borrow == 0) {
+      break;
+    }
+  }
+
+  assert(borrow == 0 && "The result is negative");
+  trim(ret);
+  return ret;
+};
+
+static void mulSchoolbook(llvm::ArrayRef<uint64_t> a,
+                          llvm::ArrayRef<uint64_t> b,
+                          llvm::MutableArrayRef<uint64_t> out) {
+  for (size_t i = 0; i < a.size(); i++) {
+    uint64_t carry = 0;
+
+    for (size_t j = 0; j < b.size(); j++) {
+      auto p = (static_cast<DoubleLimb>(a[i]) * b[j]) + out[i + j] + carry;
+      out[i + j] = static_cast<uint64_t>(p);
+      carry      = static_cast<uint64_t>(p >> 64);
+    }
+
+    out[i + b.size()] = carry;
+  }
+};
+
+static Limbs mul(llvm::ArrayRef<uint64_t> a, llvm::ArrayRef<uint64_t> b) {
+  a = trim(a);
+  b = trim(b);
+
+  if (a.empty() || b.empty()) {
+    return {};
+  }
+
+  Limbs ret(a.size() + b.size(), 0);
+
+  if (std::min(a.size(), b.size()) < KARATSUBA_THRESHOLD) {
+    mulSchoolbook(a, b, ret);
+    trim(ret);
+    return ret;
+  }
+
+  if (a.size() < b.size()) {
+    std::swap(a, b);
+  }
+
+  // Karatsuba only pays off for operands of about the same size. So we
+  // slice the longer one into chunks of the size of the shorter one and
+  // multiply each of them separately.
+  if (a.size() > b.size()) {
+    for (size_t i = 0; i < a.size(); i += b.size()) {
+      addInto(ret, mul(a.slice(i, std::min(b.size(), a.size() - i)), b), i);
+    }
+
+    trim(ret);
+    return ret;
+  }
+
+  // a = a1 * B^k + a0 and b = b1 * B^k + b0, so
+  // a * b = z2 * B^2k + (z1 - z2 - z0) * B^k + z0 where
+  // z2 = a1 * b1, z0 = a0 * b0 and z1 = (a1 + a0) * (b1 + b0)
+  auto k  = a.size() / 2;
+  auto a0 = a.take_front(k);
+  auto a1 = a.drop_front(k);
+  auto b0 = b.take_front(k);
+  auto b1 = b.drop_front(k);
+
+  auto z0 = mul(a0, b0);
+  auto z2 = mul(a1, b1);
+  auto z1 = sub(sub(mul(add(trim(a0), a1), add(trim(b0), b1)), z0), z2);
+
+  addInto(ret, z0, 0);
+  addInto(ret, z1, k);
+  addInto(ret, z2, 2 * k);
+  trim(ret);
+  return ret;
+};
+
+/// Set \p a to `a * m + c`
+static void mulAddSmall(Limbs &a, uint64_t m, uint64_t c) {
+  for (auto &limb : a) {
+    auto p = (static_cast<DoubleLimb>(limb) * m) + c;
+    limb   = static_cast<uint64_t>(p);
+    c      = static_cast<uint64_t>(p >> 64);
+  }
+
+  if (c != 0) {
+    a.push_back(c);
+  }
+};
+
+/// Set \p a to `a / d` and return the remainder
+static uint64_t divSmall(Limbs &a, uint64_t d) {
+  DoubleLimb rem = 0;
+
+  for (size_t i = a.size(); i-- > 0;) {
+    auto x = (rem << 64) | a[i];
+    a[i]   = static_cast<uint64_t>(x / d);
+    rem    = x % d;
+  }
+
+  trim(a);
+  return static_cast<uint64_t>(rem);
+};
+
+// Signed ints ================================================================
+static Signed toSigned(Value v) {
+  Signed ret;
+
+  if (isBigInt(v)) {
+    const auto *b = static_cast<const BigInt *>(getObject(v)->data);
+    ret.negative  = b->negative != 0;
+    ret.mag.assign(b->limbs, b->limbs + b->len);
+    return ret;
+  }
+
+  auto i       = getInt(v);
+  ret.negative = i < 0;
+  // Works for INT64_MIN too
+  auto mag = ret.negative ? ~static_cast<uint64_t>(i) + 1
+                          : static_cast<uint64_t>(i);
+
+  if (mag != 0) {
+    ret.mag.push_back(mag);
+  }
+  return ret;
+};
+
+/// Return the given int in its smallest representation
+static Value makeInt(const Signed &s) {
+  if (s.mag.empty()) {
+    return makeFixnum(0);
+  }
+
+  if (s.mag.size() == 1) {
+    auto mag = s.mag[0];
+
+    if (!s.negative && mag <= static_cast<uint64_t>(INT64_MAX)) {
+      return makeInt(static_cast<int64_t>(mag));
+    }
+
+    if (s.negative && mag <= static_cast<uint64_t>(INT64_MAX) + 1) {
+      return makeInt(static_cast<int64_t>(~mag + 1));
+    }
+  }
+
+  auto len = static_cast<uint32_t>(s.mag.size());
+  auto *b  = allocate<BigInt>(len * sizeof(uint64_t));
+
+  b->len      = len;
+  b->negative = s.negative ? 1 : 0;
+  std::memcpy(b->limbs, s.mag.data(), len * sizeof(uint64_t));
+
+  auto *o = allocate<Object>();
+  new (o) Object{getTypeIndex(TypeID::BIGINT), b};
+  return makeObject(o);
+};
+
+static Signed add(const Signed &a, const Signed &b) {
+  if (a.negative == b.negative) {
+    return Signed{a.negative, add(a.mag, b.mag)};
+  }
+
+  // The sign of the bigger magnitude wins
+  if (compare(a.mag, b.mag) >= 0) {
+    return Signed{a.negative, sub(a.mag, b.mag)};
+  }
+
+  return Signed{b.negative, sub(b.mag, a.mag)};
+};
+
+static Signed negate(Signed s) {
+  s.negative = !s.negative;
+  return s;
+};
+
+// ============================================================================
+// Public API
+// ============================================================================
+Value makeInt(int64_t i) {
+  if (fitsInFixnum(i)) {
+    return makeFixnum(i);
+  }
+
+  auto *num = allocate<Number>();
+  new (num) Number{i};
+
+  auto *o = allocate<Object>();
+  new (o) Object{getTypeIndex(TypeID::NUMBER), num};
+  return makeObject(o);
+};
+
+bool isInt(Value v) {
+  if (isFixnum(v)) {
+    return true;
+  }
+
+  if (!isObject(v)) {
+    return false;
+  }
+
+  auto id = getType(getObject(v)->type)->id;
+  return id == TypeID::NUMBER || id == TypeID::BIGINT;
+};
+
+bool isBigInt(Value v) {
+  return isObject(v) && getType(getObject(v)->type)->id == TypeID::BIGINT;
+};
+
+int64_t getInt(Value v) {
+  assert(isInt(v) && !isBigInt(v) && "The value is not a 64 bit int");
+
+  if (isFixnum(v)) {
+    return getFixnum(v);
+  }
+
+  return static_cast<const Number *>(getObject(v)->data)->data;
+};
+
+Value parseInt(llvm::StringRef digits) {
+  Signed ret;
+  ret.negative = digits.consume_front("-");
+
+  assert(!digits.empty() && "There's no digit to parse");
+
+  // Parse 19 digits at a time, starting with the leftover at the front
+  auto chunk = digits.size() % DECIMAL_DIGITS;
+  if (chunk == 0) {
+    chunk = DECIMAL_DIGITS;
+  }
+
+  while (!digits.empty()) {
+    uint64_t c = 0;
+    uint64_t m = 1;
+
+    for (auto d : digits.take_front(chunk)) {
+      assert(d >= '0' && d <= '9' && "Not a decimal digit");
+      c = (c * 10) + static_cast<uint64_t>(d - '0');
+      m *= 10;
+    }
+
+    mulAddSmall(ret.mag, m, c);
+    trim(ret.mag);
+
+    digits = digits.drop_front(chunk);
+    chunk  = DECIMAL_DIGITS;
+  }
+
+  return makeInt(ret);
+};
+
+std::string intToString(Value v) {
+  assert(isInt(v) && "The value is not an int");
+
+  auto s = toSigned(v);
+
+  if (s.mag.empty()) {
+    return "0";
+  }
+
+  // The chunks of 19 digits, the least significant one first
+  llvm::SmallVector<uint64_t, 8> chunks;
+  while (!s.mag.empty()) {
+    chunks.push_back(divSmall(s.mag, DECIMAL_BASE));
+  }
+
+  std::string ret = s.negative ? "-" : "";
+  ret += std::to_string(chunks.back());
+
+  for (size_t i = chunks.size() - 1; i-- > 0;) {
+    auto chunk = std::to_string(chunks[i]);
+    ret.append(DECIMAL_DIGITS - chunk.size(), '0');
+    ret += chunk;
+  }
+
+  return ret;
+};
+
+/// Apply the checked 64 bit operation \p op to the ints \p a and \p b and
+/// fall back to \p bigOp if any of them is a `BigInt` or \p op overflows
+template <typename Op, typename BigOp>
+static Value apply(Value a, Value b, Op op, BigOp bigOp) {
+  if (!isInt(a) || !isInt(b)) {
+    llvm::report_fatal_error("Wrong argument type for an arithmetic operation");
+  }
+
+  if (!isBigInt(a) && !isBigInt(b)) {
+    int64_t r = 0;
+
+    if (!op(getInt(a), getInt(b), &r)) {
+      return makeInt(r);
+    }
+  }
+
+  return makeInt(bigOp(toSigned(a), toSigned(b)));
+};
+
+Value add(Value a, Value b) {
+  Value r = 0;
+
+  if (isFixnum(a) && isFixnum(b) && addFixnums(a, b, &r)) {
+    return r;
+  }
+
+  return apply(
+      a, b,
+      [](int64_t x, int64_t y, int64_t *r) {
+        return __builtin_add_overflow(x, y, r);
+      },
+      [](const Signed &x, const Signed &y) { return add(x, y); });
+};
+
+Value sub(Value a, Value b) {
+  Value r = 0;
+
+  if (isFixnum(a) && isFixnum(b) && subFixnums(a, b, &r)) {
+    return r;
+  }
+
+  return apply(
+      a, b,
+      [](int64_t x, int64_t y, int64_t *r) {
+        return __builtin_sub_overflow(x, y, r);
+      },
+      [](const Signed &x, const Signed &y) { return add(x, negate(y)); });
+};
+
+Value mul(Value a, Value b) {
+  Value r = 0;
+
+  if (isFixnum(a) && isFixnum(b) && mulFixnums(a, b, &r)) {
+    return r;
+  }
+
+  return apply(
+      a, b,
+      [](int64_t x, int64_t y, int64_t *r) {
+        return __builtin_mul_overflow(x, y, r);
+      },
+      [](const Signed &x, const Signed &y) {
+        return Signed{x.negative != y.negative, mul(x.mag, y.mag)};
+      });
+};
+
+} // namespace serene::runtime
+
+extern "C" Value __serene_add(Value a, Value b) {
+  return serene::runtime::add(a, b);
+};
+
+extern "C" Value __serene_sub(Value a, Value b) {
+  return serene::runtime::sub(a, b);
+};
+
+extern "C" Value __serene_mul(Value a, Value b) {
+  return serene::runtime::mul(a, b);
+};
@@ -0,0 +1,81 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Commentary:
+ * The generic arithmetic of the runtime. An int is a fixnum if it fits in
+ * 63 bits, a boxed `Number` if it fits in 64 bits and a `BigInt` otherwise
+ * (look at `types.h`). The JIT'd code does the fixnum cases inline (look
+ * at `jit/arith.h`) and only calls the `__serene_*` functions of this file
+ * for the rest, e.g. when the result doesn't fit in a fixnum anymore.
+ *
+ * The ints are always in their smallest representation. An operation on
+ * ints of 64 bits only goes to the `BigInt`s if it overflows and a
+ * `BigInt` result that fits in 64 bits goes back to a `Number` or a
+ * fixnum. The `BigInt`s multiply via Karatsuba once both of them have
+ * `KARATSUBA_THRESHOLD` limbs or more.
+ */
+
+#ifndef RUNTIME_NUMBER_H
+#define RUNTIME_NUMBER_H
+
+#include "types.h"
+
+#include <llvm/ADT/StringRef.h>
+
+#include <cstdint>
+#include <string>
+
+namespace serene::runtime {
+
+/// Below this number of limbs the schoolbook multiplication is faster
+constexpr size_t KARATSUBA_THRESHOLD = 32;
+
+/// Return the given int \p i as a fixnum or as a boxed `Number` if it
+/// doesn't fit in a fixnum
+Value makeInt(int64_t i);
+
+/// Return whether \p v is an int, either a fixnum, a boxed `Number` or a
+/// `BigInt`
+bool isInt(Value v);
+
+bool isBigInt(Value v);
+
+/// Return the int of \p v. It has to be an int that is not a `BigInt`.
+int64_t getInt(Value v);
+
+/// Return the int of the given decimal \p digits with an optional `-` in
+/// front of them, e.g. an int literal of any length
+Value parseInt(llvm::StringRef digits);
+
+/// Return the decimal representation of the int \p v
+std::string intToString(Value v);
+
+Value add(Value a, Value b);
+Value sub(Value a, Value b);
+Value mul(Value a, Value b);
+
+} // namespace serene::runtime
+
+/// The slow paths of the arithmetic of the JIT'd code. They allocate but
+/// never collect.
+extern "C" Value __serene_add(Value a, Value b);
+extern "C" Value __serene_sub(Value a, Value b);
+extern "C" Value __serene_mul(Value a, Value b);
+
+#endif
@@ -0,0 +1,132 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "runtime/string.h"
+
+#include "runtime/heap.h"
+
+#include <cassert>
+#include <cstring>
+
+namespace serene::runtime {
+
+/// Allocate a string of \p len bytes and set \p bytes to where its bytes
+/// go. The bytes are followed by a NUL.
+static String *allocateString(uint32_t len, char **bytes) {
+  auto *s = allocate<String>();
+  s->len  = len;
+
+  if (len <= STRING_INLINE_SIZE) {
+    s->kind = SERENE_STRING_INLINE;
+    *bytes  = s->bytes;
+  } else {
+    // The bytes are a separate object, since the references can't point
+    // into the middle of an object
+    auto *buffer = static_cast<char *>(allocate(len + 1, Layout::Raw));
+    s->kind      = SERENE_STRING_FLAT;
+    s->data      = buffer;
+    *bytes       = buffer;
+  }
+
+  (*bytes)[len] = '\0';
+  return s;
+};
+
+/// Copy the bytes of \p s to \p out and return the end of the copy
+static char *copyBytes(const String *s, char *out) {
+  forEachPiece(s, [&](llvm::StringRef piece) {
+    std::memcpy(out, piece.data(), piece.size());
+    out += piece.size();
+  });
+
+  return out;
+};
+
+const String *makeString(llvm::StringRef s) {
+  assert(s.size() <= UINT32_MAX && "The string is too long");
+
+  char *bytes = nullptr;
+  auto *ret   = allocateString(static_cast<uint32_t>(s.size()), &bytes);
+  std::memcpy(bytes, s.data(), s.size());
+  return ret;
+};
+
+const String *makeStaticString(llvm::StringRef s) {
+  assert(s.size() <= UINT32_MAX && "The string is too long");
+
+  if (s.size() <= STRING_INLINE_SIZE) {
+    return makeString(s);
+  }
+
+  auto *ret = allocate<String>();
+  ret->len  = static_cast<uint32_t>(s.size());
+  ret->kind = SERENE_STRING_FLAT;
+  ret->data = s.data();
+  return ret;
+};
+
+const String *concat(const String *a, const String *b) {
+  if (a->len == 0) {
+    return b;
+  }
+
+  if (b->len == 0) {
+    return a;
+  }
+
+  assert(uint64_t{a->len} + b->len <= UINT32_MAX && "The string is too long");
+  auto len = a->len + b->len;
+
+  if (len < ROPE_MIN_SIZE) {
+    char *bytes = nullptr;
+    auto *ret   = allocateString(len, &bytes);
+    copyBytes(b, copyBytes(a, bytes));
+    return ret;
+  }
+
+  auto *rope      = allocate<Rope>();
+  rope->base.len  = len;
+  rope->base.kind = SERENE_STRING_ROPE;
+  rope->base.data = nullptr;
+  rope->left      = a;
+  rope->right     = b;
+  return &rope->base;
+};
+
+const char *flatten(const Rope *rope) {
+  if (const auto *data = __atomic_load_n(&rope->base.data, __ATOMIC_ACQUIRE)) {
+    return data;
+  }
+
+  auto len     = rope->base.len;
+  auto *buffer = static_cast<char *>(allocate(len + 1, Layout::Raw));
+  auto *end    = copyBytes(&rope->base, buffer);
+  *end         = '\0';
+
+  assert(end == buffer + len && "The rope doesn't match its length");
+
+  // Two threads might flatten the same rope at the same time, but their
+  // bytes are the same, so it doesn't matter which one wins. From now on
+  // the halves are garbage unless someone else uses them.
+  auto *r = const_cast<Rope *>(rope);
+  writeBarrier(r);
+  __atomic_store_n(&r->base.data, buffer, __ATOMIC_RELEASE);
+  return buffer;
+};
+
+} // namespace serene::runtime
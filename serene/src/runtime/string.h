@@ -0,0 +1,116 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Commentary:
+ * The operations on the immutable `String` of the runtime (look at
+ * `types.h` for the layout). A string is one of:
+ *
+ * - Inline: up to 15 bytes are stored in the string itself, so a short
+ *   string is one small allocation and reading it doesn't chase a pointer.
+ * - Flat: the string points to its bytes, either in the GC heap or out of
+ *   it, e.g. the literals of the JIT'd code.
+ * - Rope: the concatenation of two strings. `concat` on long strings just
+ *   makes a rope without copying any bytes, so building a string out of
+ *   many pieces (e.g. a loop of `str`s) is O(n) instead of O(n^2). The
+ *   first time that someone needs the bytes of a rope, `getBytes`
+ *   flattens it and keeps the flat bytes in the rope.
+ *
+ * Short concatenations are copied right away, since a rope node costs
+ * more than copying a few bytes.
+ */
+
+#ifndef RUNTIME_STRING_H
+#define RUNTIME_STRING_H
+
+#include "types.h"
+
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringRef.h>
+
+#include <cstdint>
+
+namespace serene::runtime {
+
+constexpr uint32_t STRING_INLINE_SIZE = SERENE_STRING_INLINE_SIZE;
+/// Concatenations shorter than this are copied instead of making a rope
+constexpr uint32_t ROPE_MIN_SIZE = 128;
+
+/// Create a string with a copy of the bytes of \p s
+const String *makeString(llvm::StringRef s);
+
+/// Create a string that points to the bytes of \p s without copying them.
+/// They have to be out of the GC heap and live as long as the string,
+/// e.g. static data.
+const String *makeStaticString(llvm::StringRef s);
+
+inline uint32_t size(const String *s) { return s->len; };
+
+/// Return a string of the bytes of \p a followed by the bytes of \p b
+const String *concat(const String *a, const String *b);
+
+/// Flatten the given \p rope if it's not flat already and return its bytes
+const char *flatten(const Rope *rope);
+
+/// Return the bytes of \p s. The first call on a rope flattens it, which
+/// is O(n). The bytes might be in the GC heap, so they're only valid until
+/// the next safepoint.
+inline llvm::StringRef getBytes(const String *s) {
+  if (s->kind == SERENE_STRING_INLINE) {
+    return llvm::StringRef(s->bytes, s->len);
+  }
+
+  const auto *data = __atomic_load_n(&s->data, __ATOMIC_ACQUIRE);
+
+  if (data == nullptr) {
+    data = flatten(reinterpret_cast<const Rope *>(s));
+  }
+
+  return llvm::StringRef(data, s->len);
+};
+
+/// Call \p fn with each contiguous piece of the bytes of \p s in order. It
+/// doesn't flatten the ropes.
+template <typename Fn>
+void forEachPiece(const String *s, Fn fn) {
+  llvm::SmallVector<const String *, 16> stack{s};
+
+  while (!stack.empty()) {
+    const auto *str = stack.pop_back_val();
+
+    if (str->kind == SERENE_STRING_INLINE) {
+      fn(llvm::StringRef(str->bytes, str->len));
+      continue;
+    }
+
+    const auto *data = __atomic_load_n(&str->data, __ATOMIC_ACQUIRE);
+
+    if (data != nullptr) {
+      fn(llvm::StringRef(data, str->len));
+      continue;
+    }
+
+    const auto *rope = reinterpret_cast<const Rope *>(str);
+    stack.push_back(rope->right);
+    stack.push_back(rope->left);
+  }
+};
+
+} // namespace serene::runtime
+
+#endif
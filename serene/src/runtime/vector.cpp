@@ -0,0 +1,216 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "runtime/vector.h"
+
+#include "runtime/heap.h"
+
+#include <atomic>
+#include <cstring>
+
+namespace serene::runtime {
+
+/// Persistent nodes don't belong to any transient
+constexpr uint64_t NO_OWNER = 0;
+
+static std::atomic<uint64_t> lastOwner{NO_OWNER};
+
+static VectorNode *newNode(uint64_t owner) {
+  auto *node  = allocate<VectorNode>();
+  node->owner = owner;
+  std::memset(node->children, 0, sizeof(node->children));
+  return node;
+};
+
+/// Return a version of \p node that \p owner can change in place. It's the
+/// node itself if the owner already owns it or a copy otherwise.
+static VectorNode *getEditable(const VectorNode *node, uint64_t owner) {
+  if (owner != NO_OWNER && node->owner == owner) {
+    writeBarrier(node);
+    return const_cast<VectorNode *>(node);
+  }
+
+  auto *copy  = allocate<VectorNode>();
+  *copy       = *node;
+  copy->owner = owner;
+  return copy;
+};
+
+/// Create the chain of nodes from \p level down to the given leaf \p node
+static const VectorNode *newPath(uint64_t owner, uint32_t level,
+                                 const VectorNode *node) {
+  if (level == 0) {
+    return node;
+  }
+
+  auto *ret        = newNode(owner);
+  ret->children[0] = newPath(owner, level - SERENE_VECTOR_BITS, node);
+  return ret;
+};
+
+/// Insert the full \p tail of a vector of \p len elements in the trie
+static const VectorNode *pushTail(uint64_t owner, uint32_t len, uint32_t level,
+                                  const VectorNode *parent,
+                                  const VectorNode *tail) {
+  auto subidx = ((len - 1) >> level) & SERENE_VECTOR_MASK;
+  auto *ret   = getEditable(parent, owner);
+
+  const VectorNode *child = nullptr;
+
+  if (level == SERENE_VECTOR_BITS) {
+    child = tail;
+  } else if (const auto *next = parent->children[subidx]) {
+    child = pushTail(owner, len, level - SERENE_VECTOR_BITS, next, tail);
+  } else {
+    child = newPath(owner, level - SERENE_VECTOR_BITS, tail);
+  }
+
+  ret->children[subidx] = child;
+  return ret;
+};
+
+static const VectorNode *doAssoc(uint64_t owner, uint32_t level,
+                                 const VectorNode *node, uint32_t i, Value x) {
+  auto *ret = getEditable(node, owner);
+
+  if (level == 0) {
+    ret->values[i & SERENE_VECTOR_MASK] = x;
+  } else {
+    auto subidx           = (i >> level) & SERENE_VECTOR_MASK;
+    ret->children[subidx] = doAssoc(owner, level - SERENE_VECTOR_BITS,
+                                    node->children[subidx], i, x);
+  }
+
+  return ret;
+};
+
+/// Append \p x to \p v. The nodes of the \p owner change in place.
+static void doConj(Vector &v, uint64_t owner, Value x) {
+  auto tailLen = v.len - getTailOffset(v);
+
+  if (tailLen < SERENE_VECTOR_WIDTH) {
+    auto *tail            = getEditable(v.tail, owner);
+    tail->values[tailLen] = x;
+    v.tail                = tail;
+    v.len++;
+    return;
+  }
+
+  // The tail is full and has to go to the trie. If the root is full too,
+  // the trie grows one level.
+  if ((v.len >> SERENE_VECTOR_BITS) > (1U << v.shift)) {
+    auto *root        = newNode(owner);
+    root->children[0] = v.root;
+    root->children[1] = newPath(owner, v.shift, v.tail);
+    v.root            = root;
+    v.shift += SERENE_VECTOR_BITS;
+  } else {
+    v.root = pushTail(owner, v.len, v.shift, v.root, v.tail);
+  }
+
+  auto *tail      = newNode(owner);
+  tail->values[0] = x;
+  v.tail          = tail;
+  v.len++;
+};
+
+static void doAssoc(Vector &v, uint64_t owner, uint32_t i, Value x) {
+  assert(i <= v.len && "The index is out of range");
+
+  if (i == v.len) {
+    doConj(v, owner, x);
+    return;
+  }
+
+  if (i >= getTailOffset(v)) {
+    auto *tail                           = getEditable(v.tail, owner);
+    tail->values[i & SERENE_VECTOR_MASK] = x;
+    v.tail                               = tail;
+    return;
+  }
+
+  v.root = doAssoc(owner, v.shift, v.root, i, x);
+};
+
+Vector emptyVector() {
+  // All the empty vectors can share the same nodes since they never change.
+  // It's out of the GC heap, so it never moves.
+  static const VectorNode empty{};
+  return Vector{0, SERENE_VECTOR_BITS, &empty, &empty};
+};
+
+Vector makeVector(llvm::ArrayRef<Value> elements) {
+  TransientVector t(emptyVector());
+
+  for (auto x : elements) {
+    t.conj(x);
+  }
+
+  return t.persistent();
+};
+
+Value nth(const Vector &v, uint32_t i) {
+  assert(i < v.len && "The index is out of range");
+
+  if (i >= getTailOffset(v)) {
+    return v.tail->values[i & SERENE_VECTOR_MASK];
+  }
+
+  const auto *node = v.root;
+  for (auto level = v.shift; level > 0; level -= SERENE_VECTOR_BITS) {
+    node = node->children[(i >> level) & SERENE_VECTOR_MASK];
+  }
+
+  return node->values[i & SERENE_VECTOR_MASK];
+};
+
+Vector conj(const Vector &v, Value x) {
+  auto ret = v;
+  doConj(ret, NO_OWNER, x);
+  return ret;
+};
+
+Vector assoc(const Vector &v, uint32_t i, Value x) {
+  auto ret = v;
+  doAssoc(ret, NO_OWNER, i, x);
+  return ret;
+};
+
+// ============================================================================
+// TransientVector
+// ============================================================================
+TransientVector::TransientVector(const Vector &v)
+    : v(v), owner(lastOwner.fetch_add(1, std::memory_order_relaxed) + 1){};
+
+void TransientVector::conj(Value x) {
+  assert(owner != NO_OWNER && "The transient is already persistent");
+  doConj(v, owner, x);
+};
+
+void TransientVector::assoc(uint32_t i, Value x) {
+  assert(owner != NO_OWNER && "The transient is already persistent");
+  doAssoc(v, owner, i, x);
+};
+
+Vector TransientVector::persistent() {
+  // Nobody else has this id, so the nodes are immutable from now on
+  owner = NO_OWNER;
+  return v;
+};
+
+} // namespace serene::runtime
@@ -0,0 +1,127 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Commentary:
+ * The operations on the persistent `Vector` of the runtime (look at
+ * `types.h` for the layout). It's a bit partitioned trie with 32 children
+ * per node, so a lookup or an `assoc` touches O(log32 n) nodes, which is at
+ * most 7 for a 32 bit length. The last leaf (`tail`) lives out of the trie
+ * and `conj` only pushes it down to the trie when it's full, which makes
+ * appending O(1) amortized.
+ *
+ * Persistent operations copy the path to the changed element. For bulk
+ * construction use a `TransientVector` instead. It owns the nodes that it
+ * creates and changes them in place, so building a vector of `n` elements
+ * doesn't copy the path `n` times.
+ */
+
+#ifndef RUNTIME_VECTOR_H
+#define RUNTIME_VECTOR_H
+
+#include "types.h"
+
+#include <llvm/ADT/ArrayRef.h>
+
+#include <cassert>
+#include <cstdint>
+
+namespace serene::runtime {
+
+Vector emptyVector();
+
+/// Create a vector of the given \p elements via a transient
+Vector makeVector(llvm::ArrayRef<Value> elements);
+
+/// Return the element at the index \p i of \p v. The index has to be in
+/// the range.
+Value nth(const Vector &v, uint32_t i);
+
+/// Return a new vector with \p x appended to the end of \p v
+Vector conj(const Vector &v, Value x);
+
+/// Return a new vector with the element at index \p i set to \p x. The
+/// index can be the length of the vector that means `conj`.
+Vector assoc(const Vector &v, uint32_t i, Value x);
+
+/// Call \p fn with each leaf of \p v as a contiguous span of the elements
+template <typename Fn>
+void forEachSpan(const Vector &v, Fn fn);
+
+/// A mutable version of a vector that can only be used by one thread at a
+/// time. It shares the nodes of the vector that it was created from and
+/// only copies each node once, the first time it changes it.
+///
+/// \code
+/// TransientVector t(emptyVector());
+/// t.conj(makeFixnum(1));
+/// t.conj(makeFixnum(2));
+/// Vector v = t.persistent();
+/// \endcode
+class TransientVector {
+  Vector v;
+  /// The id of this transient in the nodes that it owns. Zero after
+  /// `persistent`.
+  uint64_t owner;
+
+public:
+  explicit TransientVector(const Vector &v);
+
+  uint32_t size() const { return v.len; };
+
+  Value nth(uint32_t i) const { return runtime::nth(v, i); };
+
+  void conj(Value x);
+  void assoc(uint32_t i, Value x);
+
+  /// Return the persistent vector and seal the nodes of the transient. The
+  /// transient can't be used anymore.
+  Vector persistent();
+};
+
+// ============================================================================
+// Implementation details
+// ============================================================================
+/// Return the index of the first element in the tail
+inline uint32_t getTailOffset(const Vector &v) {
+  return v.len < SERENE_VECTOR_WIDTH
+             ? 0
+             : ((v.len - 1) >> SERENE_VECTOR_BITS) << SERENE_VECTOR_BITS;
+};
+
+template <typename Fn>
+void forEachSpan(const Vector &v, Fn fn) {
+  auto tailOffset = getTailOffset(v);
+
+  for (uint32_t i = 0; i < tailOffset; i += SERENE_VECTOR_WIDTH) {
+    const auto *node = v.root;
+    for (auto level = v.shift; level > 0; level -= SERENE_VECTOR_BITS) {
+      node = node->children[(i >> level) & SERENE_VECTOR_MASK];
+    }
+
+    fn(llvm::ArrayRef<Value>(node->values, SERENE_VECTOR_WIDTH));
+  }
+
+  if (v.len > tailOffset) {
+    fn(llvm::ArrayRef<Value>(v.tail->values, v.len - tailOffset));
+  }
+};
+
+} // namespace serene::runtime
+
+#endif
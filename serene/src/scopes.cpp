@@ -0,0 +1,151 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "scopes.h"
+
+#include <cassert>
+
+namespace serene {
+
+// ============================================================================
+// ScopeTable
+// ============================================================================
+NameID ScopeTable::intern(llvm::StringRef name) {
+  auto [it, inserted] =
+      nameIndex.try_emplace(name, static_cast<NameID>(names.size()));
+
+  if (inserted) {
+    // The keys of the `StringMap` don't move, so we can point to them
+    names.push_back(it->getKey());
+  }
+
+  return it->getValue();
+};
+
+std::optional<NameID> ScopeTable::findName(llvm::StringRef name) const {
+  auto it = nameIndex.find(name);
+
+  if (it == nameIndex.end()) {
+    return std::nullopt;
+  }
+
+  return it->getValue();
+};
+
+ScopeID ScopeTable::addScope(ScopeID parent) {
+  assert(parent < scopes.size() && "Unknown parent scope");
+
+  auto id = static_cast<ScopeID>(scopes.size());
+  scopes.push_back({parent, scopes[parent].depth + 1});
+  return id;
+};
+
+void ScopeTable::closeScope(ScopeID id, llvm::ArrayRef<NameID> bindings) {
+  auto &s = scopes[id];
+
+  s.firstSlot  = static_cast<uint32_t>(slots.size());
+  s.numOfSlots = static_cast<uint32_t>(bindings.size());
+  slots.insert(slots.end(), bindings.begin(), bindings.end());
+};
+
+GlobalID ScopeTable::defineGlobal(NameID name) {
+  if (auto id = getGlobal(name)) {
+    return *id;
+  }
+
+  if (name >= globalOf.size()) {
+    globalOf.resize(names.size(), NO_GLOBAL);
+  }
+
+  auto id        = static_cast<GlobalID>(globals.size());
+  globalOf[name] = id;
+  globals.push_back(name);
+  return id;
+};
+
+// ============================================================================
+// ScopeResolver
+// ============================================================================
+ScopeID ScopeResolver::pushScope() {
+  auto parent = open.empty() ? ROOT_SCOPE : open.back().id;
+  auto id     = table.addScope(parent);
+
+  open.push_back({id, static_cast<uint32_t>(pending.size())});
+  return id;
+};
+
+void ScopeResolver::popScope() {
+  assert(!open.empty() && "There is no open scope to pop");
+
+  auto scope    = open.back();
+  auto bindings = llvm::ArrayRef<NameID>(pending).drop_front(
+      scope.firstBinding);
+
+  for (auto name : bindings) {
+    visible[name].pop_back();
+  }
+
+  table.closeScope(scope.id, bindings);
+  pending.resize(scope.firstBinding);
+  open.pop_back();
+};
+
+LocalIndex ScopeResolver::bind(NameID name) {
+  assert(!open.empty() && "Top level bindings are globals");
+
+  if (name >= visible.size()) {
+    visible.resize(table.getNumOfNames());
+  }
+
+  auto slot = static_cast<uint32_t>(pending.size()) - open.back().firstBinding;
+
+  pending.push_back(name);
+  visible[name].push_back({getDepth(), slot});
+
+  return {0, slot};
+};
+
+Resolution ScopeResolver::resolve(NameID name) const {
+  Resolution r;
+
+  if (name < visible.size() && !visible[name].empty()) {
+    const auto &b = visible[name].back();
+
+    r.kind  = Resolution::Kind::Local;
+    r.local = {getDepth() - b.depth, b.slot};
+    return r;
+  }
+
+  if (auto id = table.getGlobal(name)) {
+    r.kind   = Resolution::Kind::Global;
+    r.global = *id;
+  }
+
+  return r;
+};
+
+Resolution ScopeResolver::resolve(llvm::StringRef name) const {
+  if (auto id = table.findName(name)) {
+    return resolve(*id);
+  }
+
+  // A name that is never interned can't be bound
+  return {};
+};
+
+} // namespace serene
@@ -0,0 +1,230 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Commentary:
+ * `Environment` resolves a name by hashing it at every level of the scope
+ * chain, so resolving all the symbols of a deeply nested `let` or `fn`
+ * costs O(depth * hash) per symbol. The semantic analyzer and the codegen
+ * use the flat representation in this file instead:
+ *
+ * - Names are interned once and from then on they are just a `NameID`.
+ * - Each local binding gets a `LocalIndex`: the number of scopes between
+ *   the use and the scope of the binding (`depth`) and the position of the
+ *   binding in its scope (`slot`). The codegen uses it to index the frames
+ *   directly.
+ * - Each global gets an interned `GlobalID` that is an index to the
+ *   globals table of the namespace.
+ * - `ScopeTable` keeps all the scopes of a namespace in one vector and the
+ *   bindings of each scope are a contiguous range of another vector.
+ *
+ * `ScopeResolver` walks the scopes during the analysis. It keeps a stack of
+ * the visible bindings of each name, so resolving a name is one hash (or
+ * just an array index with a `NameID`) regardless of the depth of the
+ * scope chain.
+ */
+
+#ifndef SCOPES_H
+#define SCOPES_H
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringRef.h>
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace serene {
+
+using NameID   = uint32_t;
+using ScopeID  = uint32_t;
+using GlobalID = uint32_t;
+
+/// The top level scope of a namespace. Its bindings are the globals.
+constexpr ScopeID ROOT_SCOPE = 0;
+
+/// The address of a local binding relative to the scope that uses it
+struct LocalIndex {
+  /// The number of scopes to go up, zero means the current scope
+  uint32_t depth;
+  /// The index of the binding in its scope
+  uint32_t slot;
+};
+
+struct Resolution {
+  enum class Kind : uint8_t { Unbound, Local, Global };
+
+  Kind kind = Kind::Unbound;
+  /// Only valid for the `Local` kind
+  LocalIndex local{0, 0};
+  /// Only valid for the `Global` kind
+  GlobalID global = 0;
+
+  bool isLocal() const { return kind == Kind::Local; };
+  bool isGlobal() const { return kind == Kind::Global; };
+  bool isUnbound() const { return kind == Kind::Unbound; };
+};
+
+/// The flat storage of the scopes and bindings of a namespace.
+class ScopeTable {
+public:
+  struct Scope {
+    ScopeID parent;
+    /// The number of scopes above this one, zero for the root scope
+    uint32_t depth;
+    /// The bindings of the scope in `slots`. They are set when the scope
+    /// is closed, look at `closeScope`.
+    uint32_t firstSlot  = 0;
+    uint32_t numOfSlots = 0;
+  };
+
+private:
+  std::vector<Scope> scopes;
+  /// The names of the bindings of all the scopes. Bindings of each scope
+  /// are next to each other.
+  std::vector<NameID> slots;
+
+  std::vector<llvm::StringRef> names;
+  llvm::StringMap<NameID> nameIndex;
+
+  /// `GlobalID` -> `NameID`
+  std::vector<NameID> globals;
+  /// `NameID` -> `GlobalID` or `NO_GLOBAL`
+  std::vector<GlobalID> globalOf;
+
+  constexpr static GlobalID NO_GLOBAL = UINT32_MAX;
+
+public:
+  ScopeTable() { scopes.push_back({ROOT_SCOPE, 0}); };
+
+  ScopeTable(const ScopeTable &)            = delete;
+  ScopeTable &operator=(const ScopeTable &) = delete;
+
+  /// Return the id of the given \p name and intern it if it's new.
+  NameID intern(llvm::StringRef name);
+
+  /// Return the id of the given \p name if it's interned already.
+  std::optional<NameID> findName(llvm::StringRef name) const;
+
+  llvm::StringRef getName(NameID id) const { return names[id]; };
+
+  size_t getNumOfNames() const { return names.size(); };
+
+  /// Add a new scope under the given \p parent and return its id.
+  ScopeID addScope(ScopeID parent);
+
+  /// Store the names of the bindings of the given scope \p id in the order
+  /// of their slots. It's called once the scope is closed.
+  void closeScope(ScopeID id, llvm::ArrayRef<NameID> bindings);
+
+  const Scope &getScope(ScopeID id) const { return scopes[id]; };
+
+  size_t getNumOfScopes() const { return scopes.size(); };
+
+  /// Return the names of the bindings of the given (closed) scope \p id
+  /// indexed by their slot.
+  llvm::ArrayRef<NameID> getBindings(ScopeID id) const {
+    const auto &s = scopes[id];
+    return llvm::ArrayRef<NameID>(slots).slice(s.firstSlot, s.numOfSlots);
+  };
+
+  /// Define a global with the given \p name and return its id. Defining
+  /// the same name again returns the same id.
+  GlobalID defineGlobal(NameID name);
+  GlobalID defineGlobal(llvm::StringRef name) {
+    return defineGlobal(intern(name));
+  };
+
+  std::optional<GlobalID> getGlobal(NameID name) const {
+    if (name >= globalOf.size() || globalOf[name] == NO_GLOBAL) {
+      return std::nullopt;
+    }
+    return globalOf[name];
+  };
+
+  NameID getGlobalName(GlobalID id) const { return globals[id]; };
+
+  size_t getNumOfGlobals() const { return globals.size(); };
+};
+
+/// Resolves the names to `LocalIndex`es and `GlobalID`s while the analyzer
+/// walks the scopes. Here is an example for `(fn (x) (let (y x) y))`:
+/// \code
+/// ScopeResolver r(ns.environments);
+/// r.pushScope();   // fn
+/// r.bind("x");     // -> {0, 0}
+/// r.pushScope();   // let
+/// r.resolve("x");  // -> Local {1, 0}
+/// r.bind("y");     // -> {0, 0}
+/// r.popScope();
+/// r.popScope();
+/// \endcode
+class ScopeResolver {
+  ScopeTable &table;
+
+  struct OpenScope {
+    ScopeID id;
+    /// The index of the first binding of the scope in `pending`
+    uint32_t firstBinding;
+  };
+
+  /// The chain of open scopes from the outermost to the current one. The
+  /// root scope is not in it.
+  std::vector<OpenScope> open;
+
+  /// The bindings of the open scopes. Only the current scope can have new
+  /// bindings, so the bindings of each open scope are next to each other.
+  std::vector<NameID> pending;
+
+  struct Visible {
+    uint32_t depth;
+    uint32_t slot;
+  };
+
+  /// The local bindings of each name that are visible from the current
+  /// scope, indexed by `NameID`. The last one shadows the others.
+  std::vector<llvm::SmallVector<Visible, 1>> visible;
+
+public:
+  explicit ScopeResolver(ScopeTable &table) : table(table){};
+
+  /// Open a new scope under the current one and return its id.
+  ScopeID pushScope();
+
+  /// Close the current scope and move its bindings to the table.
+  void popScope();
+
+  /// Return the depth of the current scope, zero means the root scope.
+  uint32_t getDepth() const { return static_cast<uint32_t>(open.size()); };
+
+  /// Add a local binding for the given \p name to the current scope and
+  /// return its index. It shadows any other binding with the same name.
+  LocalIndex bind(NameID name);
+  LocalIndex bind(llvm::StringRef name) { return bind(table.intern(name)); };
+
+  /// Resolve the given \p name from the current scope. Locals shadow the
+  /// globals.
+  Resolution resolve(NameID name) const;
+  Resolution resolve(llvm::StringRef name) const;
+};
+
+} // namespace serene
+
+#endif
@@ -18,6 +18,7 @@
 
 #include "source_mgr.h"
 
+#include "artifact.h"
 #include "errors.h"
 #include "jit/jit.h"
 #include "location.h"
@@ -76,6 +77,44 @@ SourceMgr::MemBufPtr SourceMgr::findFileInLoadPath(const std::string &name,
   return nullptr;
 };
 
+std::optional<ast::Ast> SourceMgr::loadFromArtifact(const std::string &name,
+                                                    llvm::StringRef srcFile,
+                                                    llvm::StringRef src) {
+  auto path = artifact::getArtifactPath(srcFile);
+
+  // We don't need a null terminated buffer and we don't want to copy the
+  // content, so let the `MemoryBuffer` to mmap the file if it can
+  auto bufOrErr = llvm::MemoryBuffer::getFile(path, /*IsText=*/false,
+                                              /*RequiresNullTerminator=*/false);
+  if (!bufOrErr) {
+    return std::nullopt;
+  }
+
+  auto maybeArtifact = artifact::Artifact::load(std::move(*bufOrErr), name);
+
+  if (!maybeArtifact) {
+    SMGR_LOG("Ignoring the invalid artifact: " + path);
+    llvm::consumeError(maybeArtifact.takeError());
+    return std::nullopt;
+  }
+
+  if (!maybeArtifact->isValidFor(src)) {
+    SMGR_LOG("The artifact is outdated: " + path);
+    return std::nullopt;
+  }
+
+  auto maybeAst = maybeArtifact->getAst(name, srcFile);
+
+  if (!maybeAst) {
+    SMGR_LOG("Couldn't decode the AST of the artifact: " + path);
+    llvm::consumeError(maybeAst.takeError());
+    return std::nullopt;
+  }
+
+  SMGR_LOG("Loaded namespace '" + name + "' from: " + path);
+  return std::move(*maybeAst);
+};
+
 ast::MaybeNS SourceMgr::readNamespace(std::string name,
                                       const LocationRange &importLoc) {
   std::string importedFile;
@@ -101,15 +140,33 @@ ast::MaybeNS SourceMgr::readNamespace(std::string name,
   // need to get a pointer to it again
   const auto *buf = getMemoryBuffer(bufferId);
 
+  std::optional<ast::Ast> cached;
+
+  if (withArtifacts) {
+    cached = loadFromArtifact(name, importedFile, buf->getBuffer());
+  }
+
   // Read the content of the buffer by passing it the reader
-  auto maybeAst = read(buf->getBuffer(), name,
-                       std::optional(llvm::StringRef(importedFile)));
+  auto maybeAst =
+      cached ? ast::MaybeAst(std::move(*cached))
+             : readParallel(buf->getBuffer(), name,
+                            std::optional(llvm::StringRef(importedFile)));
 
   if (!maybeAst) {
     SMGR_LOG("Couldn't Read namespace: " + name);
     return maybeAst.takeError();
   }
 
+  if (withArtifacts && !cached) {
+    // Failing to create the artifact is not fatal, we just have to read
+    // the namespace again next time.
+    if (auto err = artifact::write(artifact::getArtifactPath(importedFile),
+                                   name, buf->getBuffer(), *maybeAst)) {
+      SMGR_LOG("Couldn't create the artifact for: " + name);
+      llvm::consumeError(std::move(err));
+    }
+  }
+
   // Create the NS and set the AST
   auto ns = ast::makeAndCast<ast::Namespace>(
       importLoc, name, std::optional(llvm::StringRef(importedFile)));
@@ -118,6 +118,17 @@ private:
   // This is the list of directories we should search for include files in.
   std::vector<std::string> loadPaths;
 
+  /// Whether to use (and create) the precompiled artifacts of namespaces
+  /// instead of reading their source every time. Look at `artifact.h`.
+  bool withArtifacts = false;
+
+  /// Try to load the AST of the namespace \p name from the artifact of the
+  /// given \p srcFile. It returns `std::nullopt` if there is no valid
+  /// artifact for the current content of the source, \p src.
+  std::optional<ast::Ast> loadFromArtifact(const std::string &name,
+                                           llvm::StringRef srcFile,
+                                           llvm::StringRef src);
+
   // Find a namespace file with the given \p name in the load path and \r retuns
   // a unique pointer to the memory buffer containing the content or an error.
   // In the success case it will put the path of the file into the \p
@@ -143,6 +154,11 @@ public:
   /// namespace which it is looking for.
   void setLoadPaths(std::vector<std::string> &dirs) { loadPaths.swap(dirs); }
 
+  /// Enable or disable the usage of namespace artifacts. When enabled,
+  /// `readNamespace` loads the AST from the artifact of the namespace if
+  /// the source didn't change and creates the artifact otherwise.
+  void setArtifactsEnabled(bool enable) { withArtifacts = enable; }
+
   /// Return a reference to a `SrcBuffer` with the given ID \p i.
   const SrcBuffer &getBufferInfo(unsigned i) const {
     assert(isValidBufferID(i));
@@ -0,0 +1,59 @@
+/* -*- C -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+
+#define IMMEDIATE  SERENE_TYPE_FLAG_IMMEDIATE
+#define COLLECTION SERENE_TYPE_FLAG_COLLECTION
+
+// The order has to match the `TypeID` enum, the static assert below makes
+// sure of it.
+constexpr Type types[SERENE_NUM_OF_BUILTIN_TYPES] = {
+    {TypeID::NIL, IMMEDIATE, 0, "nil", nullptr},
+    {TypeID::SYMBOL, IMMEDIATE, 0, "symbol", nullptr},
+    {TypeID::TYPE, 0, sizeof(Type), "type", nullptr},
+    {TypeID::FN, 0, 0, "function", nullptr},
+    {TypeID::NS, 0, 0, "ns", nullptr},
+    {TypeID::NUMBER, 0, sizeof(Number), "number", nullptr},
+    {TypeID::INT, IMMEDIATE, 0, "int", nullptr},
+    {TypeID::BIGINT, 0, 0, "bigint", nullptr},
+    {TypeID::CSTRING, 0, 0, "cstring", nullptr},
+    {TypeID::STRING, 0, 0, "string", nullptr},
+    {TypeID::KEYWORD, IMMEDIATE, 0, "keyword", nullptr},
+    {TypeID::NAMESPACE, 0, 0, "namespace", nullptr},
+    {TypeID::LIST, COLLECTION, sizeof(List), "list", nullptr},
+    {TypeID::MAP, COLLECTION, 0, "map", nullptr},
+    {TypeID::VECTOR, COLLECTION, 0, "vector", nullptr},
+    {TypeID::STRUCT, 0, 0, "struct", nullptr},
+    {TypeID::PROTOCOL, 0, sizeof(ProtocolType), "protocol", nullptr},
+    {TypeID::Error, 0, 0, "error", nullptr},
+};
+
+static_assert(
+    [] {
+      for (uint32_t i = 0; i < SERENE_NUM_OF_BUILTIN_TYPES; i++) {
+        if (static_cast<uint32_t>(types[i].id) != i) {
+          return false;
+        }
+      }
+      return true;
+    }(),
+    "The type table is out of order");
+
+#undef IMMEDIATE
+#undef COLLECTION
@@ -16,71 +16,363 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+/**
+ * Commentary:
+ * The runtime representation of the values. It only uses plain structs and
+ * inline functions, so the JIT'd code can follow the same layout.
+ *
+ * Every value is a 64 bit word (`Value`) and the low 3 bits are its tag:
+ *
+ * - `xx...xx1`: A small int (fixnum). The upper 63 bits are the int itself.
+ * - `xx...000`: A pointer to an `Object` on the heap. Objects are at least
+ *   8 bytes aligned, so the low 3 bits of their address are always zero.
+ * - `xx...010`: `nil`.
+ * - `xx...100`: A symbol. The upper bits are the id of the interned symbol.
+ * - `xx...110`: A keyword. The upper bits are the id of the interned
+ *   keyword.
+ *
+ * So small ints, `nil`, symbols and keywords are immediate values and don't
+ * allocate. The arithmetic on fixnums works on the tagged values directly,
+ * e.g. `a + b - 1` is the tagged sum of the fixnums `a` and `b`. Ints that
+ * don't fit in 63 bits are boxed in a `Number` and the ones that don't fit
+ * in 64 bits are `BigInt`s.
+ *
+ * The type of each object is a `TypeIndex` into the global and immutable
+ * `types` table of descriptors instead of a copy of the descriptor, so an
+ * object header is just two words. The index of the builtin types is their
+ * `TypeID`. `serene/layout.h` exposes the layout of all this to the JIT'd
+ * code.
+ */
+
 #ifndef TYPES_H
 #define TYPES_H
 
 #include "serene/config.h"
+#include "serene/layout.h"
 
 #include <cstdint>
 
-typedef struct {
+/// An index to the `types` table
+typedef uint32_t TypeIndex;
+
+typedef uint64_t Value;
+
+#define SERENE_NUM_OF_BUILTIN_TYPES \
+  (static_cast<uint32_t>(TypeID::Error) + 1)
+
+/// The descriptor of a type. The hot fields for the dispatch come first.
+typedef struct alignas(SERENE_TYPE_DESCRIPTOR_SIZE) {
   const TypeID id;
+  /// `SERENE_TYPE_FLAG_*`
+  const uint32_t flags;
+  /// The size of the instances in bytes or zero if it varies
+  const uint32_t size;
   const char *name;
-
+  /// The implementation of the protocol functions or `nullptr`
+  const void *const *methods;
 } Type;
 
+/// The descriptors of all the builtin types indexed by their `TypeID`
+extern const Type types[SERENE_NUM_OF_BUILTIN_TYPES];
+
+static inline const Type *getType(TypeIndex i) { return &types[i]; }
+
+static inline TypeIndex getTypeIndex(TypeID id) {
+  return static_cast<TypeIndex>(id);
+}
+
 typedef struct {
-  const Type type;
+  const TypeIndex type;
   const void *data;
 } Object;
 
-static const Type type          = {.id = TYPE, .name = "type"};
-static const Type nil_type      = {.id = NIL, .name = "nil"};
-static const Type function_type = {.id = FN, .name = "function"};
-static const Type protocol_type = {.id = PROTOCOL, .name = "protocol"};
-static const Type int_type      = {.id = INT, .name = "int"};
-static const Type list_type     = {.id = LIST, .name = "list"};
-
 typedef struct {
-  const Type type;
-  const Type **args;
-  const Type *returnType;
+  const TypeIndex type;
+  const uint32_t numOfArgs;
+  const TypeIndex *args;
+  const TypeIndex returnType;
 } FunctionType;
 
 typedef struct {
-  const Type type;
+  const TypeIndex type;
+  const uint32_t numOfFunctions;
   const char *name;
   const FunctionType **functions;
 } ProtocolType;
 
 typedef struct {
-  const Type type;
-  const Type first;
-  const Type second;
+  const TypeIndex type;
+  const TypeIndex first;
+  const TypeIndex second;
 } PairType;
 
 typedef struct {
-  const PairType type;
+  /// Pairs of the same types share the same descriptor
+  const PairType *type;
   void *first;
   void *second;
 } Pair;
 
+/// A node of a list. Lists are unrolled linked lists of chunks and each
+/// chunk holds up to 32 elements in `elements[front, capacity)`, so walking
+/// a list is mostly a sequential read. Chunks are shared between the lists
+/// and never change, except that a `cons` can claim the free slot right
+/// before `front` if its list starts at `front`.
+typedef struct ListChunk {
+  /// The rest of the list after the last element of this chunk
+  const struct ListChunk *next;
+  uint32_t nextOffset;
+  /// Only changes atomically
+  uint32_t front;
+  uint32_t capacity;
+  // Flexible array members are standard C but only an extension in C++.
+  // GCC and Clang lay them out the same in both.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+  Value elements[];
+#pragma GCC diagnostic pop
+} ListChunk;
+
 typedef struct {
-  const Pair *head;
-  const unsigned int len;
+  /// The chunk of the first element or `nullptr` for the empty list
+  const ListChunk *chunk;
+  /// The index of the first element in `chunk`
+  uint32_t offset;
+  uint32_t len;
 } List;
 
+#define SERENE_VECTOR_BITS  5
+#define SERENE_VECTOR_WIDTH (1 << SERENE_VECTOR_BITS)
+#define SERENE_VECTOR_MASK  (SERENE_VECTOR_WIDTH - 1)
+
+/// A node of the vector trie. Inner nodes use `children` and the leaves
+/// use `values`.
+typedef struct VectorNode {
+  /// The id of the transient that can change the node in place or zero
+  uint64_t owner;
+  union {
+    const struct VectorNode *children[SERENE_VECTOR_WIDTH];
+    Value values[SERENE_VECTOR_WIDTH];
+  };
+} VectorNode;
+
+/// A persistent vector as a 32-way trie of the elements. The last (up to)
+/// 32 elements are in the `tail` leaf out of the trie, so appending only
+/// touches the trie once every 32 elements.
+typedef struct {
+  uint32_t len;
+  /// The number of bits to shift the index for the root level
+  uint32_t shift;
+  const VectorNode *root;
+  const VectorNode *tail;
+} Vector;
+
+/// A node of the hash map (CHAMP). The entries and the child nodes are in
+/// two separate arrays, each ordered by the bit of its hash fragment in
+/// `dataMap` and `nodeMap`. Nodes at the end of the hash bits are collision
+/// nodes with no bitmaps and the entries are just a list.
+typedef struct MapNode {
+  /// The id of the transient that can change the node in place or zero
+  uint64_t owner;
+  uint32_t dataMap;
+  uint32_t nodeMap;
+  uint8_t numOfEntries;
+  uint8_t numOfNodes;
+  /// How many entries and nodes fit in `slots`. Nodes of the transients
+  /// have room to grow.
+  uint8_t entryCapacity;
+  uint8_t nodeCapacity;
+  uint32_t reserved;
+  /// `entryCapacity` cached hashes, then `entryCapacity` keys, then
+  /// `entryCapacity` values and at the end `nodeCapacity` child nodes
+  // A flexible array member like `ListChunk::elements`
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+  uint64_t slots[];
+#pragma GCC diagnostic pop
+} MapNode;
+
+typedef struct {
+  const MapNode *root;
+  uint32_t len;
+} Map;
+
 typedef struct {
   const char *name;
 } Symbol;
 
-typedef struct {
-  const char *data;
-  const unsigned int len;
+/// A string of `len` bytes. The bytes of the short ones are inline and the
+/// others point to their bytes. Long concatenations are `Rope`s with the
+/// `SERENE_STRING_ROPE` kind and they only get their flat bytes once
+/// someone needs them (look at `runtime/string.h`).
+typedef struct String {
+  uint32_t len;
+  /// `SERENE_STRING_*`
+  uint8_t kind;
+  uint8_t reserved[3];
+  union {
+    /// `SERENE_STRING_INLINE`: the bytes and a NUL
+    char bytes[SERENE_STRING_INLINE_SIZE + 1];
+    /// The bytes of the other kinds. It's `nullptr` for the ropes that are
+    /// not flattened yet and only changes atomically.
+    const char *data;
+  };
 } String;
 
+/// The concatenation of the strings `left` and `right`
+typedef struct {
+  String base;
+  const String *left;
+  const String *right;
+} Rope;
+
+/// The boxed version of the ints that don't fit in a fixnum
 typedef struct {
   const long data;
 } Number;
 
+/// An int that doesn't fit in 64 bits. Its magnitude is `len` 64 bit limbs
+/// from the least significant one and the last limb is never zero.
+typedef struct {
+  uint32_t len;
+  /// Non zero for the negative ints
+  uint32_t negative;
+  // A flexible array member like `ListChunk::elements`
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+  uint64_t limbs[];
+#pragma GCC diagnostic pop
+} BigInt;
+
+// Values =====================================================================
+// The tags are in `serene/layout.h`
+
+#define SERENE_NIL static_cast<Value>(SERENE_NIL_TAG)
+
+#define SERENE_FIXNUM_MAX (INT64_MAX >> 1)
+#define SERENE_FIXNUM_MIN (INT64_MIN >> 1)
+
+static inline int isFixnum(Value v) { return (v & SERENE_FIXNUM_TAG) != 0; }
+static inline int isNil(Value v) { return v == SERENE_NIL; }
+static inline int isObject(Value v) {
+  return v != 0 && (v & SERENE_TAG_MASK) == SERENE_POINTER_TAG;
+}
+static inline int isSymbol(Value v) {
+  return (v & SERENE_TAG_MASK) == SERENE_SYMBOL_TAG;
+}
+static inline int isKeyword(Value v) {
+  return (v & SERENE_TAG_MASK) == SERENE_KEYWORD_TAG;
+}
+
+static inline int fitsInFixnum(int64_t i) {
+  return i >= SERENE_FIXNUM_MIN && i <= SERENE_FIXNUM_MAX;
+}
+
+/// The given \p i has to fit in a fixnum, look at `fitsInFixnum`
+static inline Value makeFixnum(int64_t i) {
+  return (static_cast<Value>(i) << 1) | SERENE_FIXNUM_TAG;
+}
+
+static inline int64_t getFixnum(Value v) {
+  // Arithmetic shift keeps the sign
+  return static_cast<int64_t>(v) >> 1;
+}
+
+static inline Value makeSymbol(uint32_t id) {
+  return (static_cast<Value>(id) << SERENE_TAG_BITS) | SERENE_SYMBOL_TAG;
+}
+
+static inline uint32_t getSymbolID(Value v) {
+  return static_cast<uint32_t>(v >> SERENE_TAG_BITS);
+}
+
+static inline Value makeKeyword(uint32_t id) {
+  return (static_cast<Value>(id) << SERENE_TAG_BITS) | SERENE_KEYWORD_TAG;
+}
+
+static inline uint32_t getKeywordID(Value v) {
+  return static_cast<uint32_t>(v >> SERENE_TAG_BITS);
+}
+
+static inline Value makeObject(const Object *o) {
+  return static_cast<Value>(reinterpret_cast<uintptr_t>(o));
+}
+
+static inline const Object *getObject(Value v) {
+  return reinterpret_cast<const Object *>(static_cast<uintptr_t>(v));
+}
+
+static inline TypeID getTypeID(Value v) {
+  switch (v & SERENE_TAG_MASK) {
+  case SERENE_NIL_TAG:
+    return TypeID::NIL;
+  case SERENE_SYMBOL_TAG:
+    return TypeID::SYMBOL;
+  case SERENE_KEYWORD_TAG:
+    return TypeID::KEYWORD;
+  case SERENE_POINTER_TAG:
+    return getType(getObject(v)->type)->id;
+  default:
+    return TypeID::INT;
+  }
+}
+
+// Fixnum arithmetic ==========================================================
+// These work on the tagged values and return zero if the result doesn't fit
+// in a fixnum. In that case the caller has to fall back to the boxed ints.
+
+/// Store the tagged sum of the fixnums \p a and \p b in \p result
+static inline int addFixnums(Value a, Value b, Value *result) {
+  int64_t r = 0;
+  // (2x + 1) + (2y + 1) - 1 = 2(x + y) + 1
+  if (__builtin_add_overflow(static_cast<int64_t>(a),
+                             static_cast<int64_t>(b) - 1, &r)) {
+    return 0;
+  }
+  *result = static_cast<Value>(r);
+  return 1;
+}
+
+/// Store the tagged difference of the fixnums \p a and \p b in \p result
+static inline int subFixnums(Value a, Value b, Value *result) {
+  int64_t r = 0;
+  // (2x + 1) - (2y + 1) + 1 = 2(x - y) + 1
+  if (__builtin_sub_overflow(static_cast<int64_t>(a),
+                             static_cast<int64_t>(b) - 1, &r)) {
+    return 0;
+  }
+  *result = static_cast<Value>(r);
+  return 1;
+}
+
+/// Store the tagged product of the fixnums \p a and \p b in \p result
+static inline int mulFixnums(Value a, Value b, Value *result) {
+  int64_t r = 0;
+  // (2x) * y = 2xy and the tag goes back in afterwards
+  if (__builtin_mul_overflow(static_cast<int64_t>(a - 1), getFixnum(b), &r)) {
+    return 0;
+  }
+  *result = static_cast<Value>(r) | SERENE_FIXNUM_TAG;
+  return 1;
+}
+
+// The layout that the JIT'd code expects
+#ifdef __cplusplus
+#include <cstddef>
+
+static_assert(sizeof(Type) == SERENE_TYPE_DESCRIPTOR_SIZE);
+static_assert(offsetof(Type, id) == SERENE_TYPE_ID_OFFSET);
+static_assert(offsetof(Type, flags) == SERENE_TYPE_FLAGS_OFFSET);
+static_assert(offsetof(Type, size) == SERENE_TYPE_SIZE_OFFSET);
+static_assert(offsetof(Type, name) == SERENE_TYPE_NAME_OFFSET);
+static_assert(offsetof(Type, methods) == SERENE_TYPE_METHODS_OFFSET);
+static_assert(sizeof(Object) == SERENE_OBJECT_SIZE);
+static_assert(offsetof(Object, type) == SERENE_OBJECT_TYPE_OFFSET);
+static_assert(offsetof(Object, data) == SERENE_OBJECT_DATA_OFFSET);
+static_assert(offsetof(String, len) == SERENE_STRING_LEN_OFFSET);
+static_assert(offsetof(String, kind) == SERENE_STRING_KIND_OFFSET);
+static_assert(offsetof(String, bytes) == SERENE_STRING_BYTES_OFFSET);
+static_assert(offsetof(String, data) == SERENE_STRING_BYTES_OFFSET);
+#endif
+
 #endif
@@ -0,0 +1,121 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Commentary:
+ * After an edit, `IncrementalReader` has to have the same forms at the same
+ * locations as a fresh `Reader` of the whole buffer.
+ */
+
+#include "incremental_reader.h"
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include <string>
+
+namespace serene {
+
+static std::string print(const ast::Expression &form,
+                         const LocationRange &loc) {
+  return form.toString() + " " + loc.start.toString() + "-" +
+         loc.end.toString() + "\n";
+};
+
+/// Read the given \p text from scratch and print its forms
+static std::string readFresh(llvm::StringRef text) {
+  Reader r(text, "user", std::nullopt);
+  r.recoverFromErrors();
+
+  std::string result;
+  for (const auto &form : llvm::cantFail(r.read())) {
+    result += print(*form, form->location);
+  }
+  return result;
+};
+
+static std::string printForms(const IncrementalReader &ir) {
+  std::string result;
+  for (size_t i = 0; i < ir.getNumOfForms(); i++) {
+    const auto &form = *ir.getAst()[i];
+    result += print(form, ir.getLocation(i, form.location));
+  }
+  return result;
+};
+
+struct Edit {
+  llvm::StringRef text;
+  size_t offset;
+  size_t length;
+  llvm::StringRef replacement;
+};
+
+TEST_CASE("IncrementalReader reads an edit like a fresh Reader",
+          "[incremental_reader]") {
+  auto edit = GENERATE(
+      // Typing at the end of a symbol
+      Edit{"(def abc 1)\n(foo abc)\n", 8, 0, "d"},
+      Edit{"(foo)\nabc", 9, 0, "d"}, Edit{"abc def", 3, 0, "x"},
+      // A comment that swallows the next line and gives it back
+      Edit{"(a) ; c\n(b)\n", 7, 1, ""}, Edit{"; c\n(b)\n(c)\n", 3, 1, ""},
+      Edit{"(a) ; c(b)\n(c)\n", 7, 0, "\n"});
+
+  IncrementalReader ir("user", std::nullopt);
+  ir.reset(edit.text);
+  ir.edit(edit.offset, edit.length, edit.replacement);
+
+  CHECK(printForms(ir) == readFresh(ir.getText()));
+};
+
+TEST_CASE("IncrementalReader reads around an unbalanced edit",
+          "[incremental_reader]") {
+  auto edit = GENERATE(
+      // An unclosed form or string swallows the rest of the buffer
+      Edit{"(a)\n(b)\n(c)\n", 4, 0, "("}, Edit{"(a)\n(b)\n(c)\n", 4, 0, "\""},
+      Edit{"(a)\n(b)\n(c)\n", 0, 0, "["},
+      // A stray closing char completes a broken form before it
+      Edit{"(a (b)\n(c)\n", 6, 0, ")"}, Edit{"(a\n(b)\n(c)\n", 6, 0, ")"},
+      Edit{"(a [b\n(c)\n(d)\n", 10, 0, "])"});
+
+  IncrementalReader ir("user", std::nullopt);
+  ir.reset(edit.text);
+  ir.edit(edit.offset, edit.length, edit.replacement);
+
+  CHECK(printForms(ir) == readFresh(ir.getText()));
+};
+
+TEST_CASE("IncrementalReader follows the typing of a form",
+          "[incremental_reader]") {
+  llvm::StringRef typed = "(def f [x] ; c\n  (str \"a(\" x))";
+
+  IncrementalReader ir("user", std::nullopt);
+  ir.reset("(a)\n\n(b)\n");
+
+  for (size_t i = 0; i < typed.size(); i++) {
+    ir.edit(4 + i, 0, typed.substr(i, 1));
+    CHECK(printForms(ir) == readFresh(ir.getText()));
+  }
+
+  // And deleting it from the end
+  for (size_t i = typed.size(); i-- > 0;) {
+    ir.edit(4 + i, 1, "");
+    CHECK(printForms(ir) == readFresh(ir.getText()));
+  }
+};
+
+} // namespace serene
@@ -0,0 +1,170 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Commentary:
+ * Each function of the test module is a single `emitArith` of its two
+ * arguments. The generic arithmetic of the runtime is linked through
+ * counters, so the tests can tell the fast path from the fallback.
+ */
+
+#include "jit/arith.h"
+#include "jit/utils.h"
+#include "runtime/number.h"
+
+#include <llvm/IR/IRBuilder.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+
+namespace serene::jit {
+
+using ArithFn = ::Value(::Value, ::Value);
+
+static uint64_t numOfSlowCalls = 0;
+
+extern "C" ::Value countingAdd(::Value a, ::Value b) {
+  numOfSlowCalls++;
+  return __serene_add(a, b);
+};
+
+extern "C" ::Value countingSub(::Value a, ::Value b) {
+  numOfSlowCalls++;
+  return __serene_sub(a, b);
+};
+
+extern "C" ::Value countingMul(::Value a, ::Value b) {
+  numOfSlowCalls++;
+  return __serene_mul(a, b);
+};
+
+/// JIT `add`, `sub` and `mul` for the unknown values, the same with the
+/// `Fixnum` suffix for the fixnums and `fmul` for the unboxed floats.
+static std::unique_ptr<llvm::orc::LLJIT> makeArithJIT() {
+  auto ctx = std::make_unique<llvm::LLVMContext>();
+  auto m   = std::make_unique<llvm::Module>("arith", *ctx);
+  llvm::IRBuilder<> builder(*ctx);
+  auto *ref = llvm::PointerType::get(*ctx, GC_ADDRESS_SPACE);
+
+  auto addFunction = [&](llvm::StringRef name, llvm::Type *type,
+                         ArithOp op, NumericHint hint) {
+    auto *fn = llvm::Function::Create(
+        llvm::FunctionType::get(type, {type, type}, false),
+        llvm::Function::ExternalLinkage, name, *m);
+    fn->setGC(GC_STRATEGY_NAME);
+    builder.SetInsertPoint(llvm::BasicBlock::Create(*ctx, "entry", fn));
+    builder.CreateRet(
+        emitArith(builder, op, fn->getArg(0), fn->getArg(1), hint));
+  };
+
+  const std::pair<llvm::StringRef, ArithOp> ops[] = {
+      {"add", ArithOp::Add}, {"sub", ArithOp::Sub}, {"mul", ArithOp::Mul}};
+
+  for (const auto &[name, op] : ops) {
+    addFunction(name, ref, op, NumericHint::Unknown);
+    addFunction((name + "Fixnum").str(), ref, op, NumericHint::Fixnum);
+  }
+  addFunction("fmul", builder.getDoubleTy(), ArithOp::Mul, NumericHint::Float);
+
+  return makeTestJIT(std::move(m), std::move(ctx),
+                     {{ARITH_ADD_FN, reinterpret_cast<void *>(&countingAdd)},
+                      {ARITH_SUB_FN, reinterpret_cast<void *>(&countingSub)},
+                      {ARITH_MUL_FN, reinterpret_cast<void *>(&countingMul)}});
+};
+
+TEST_CASE("The JIT'd arithmetic of the fixnums stays inline", "[jit]") {
+  auto jit = makeArithJIT();
+
+  // The products with the second operands still fit in a fixnum
+  const int64_t values[] = {0, 1, -1, 7, -1000, 3037000499LL, 1LL << 31,
+                            SERENE_FIXNUM_MAX / 2048, SERENE_FIXNUM_MIN / 2048};
+
+  for (const auto *suffix : {"", "Fixnum"}) {
+    auto *add = lookup<ArithFn>(*jit, std::string("add") + suffix);
+    auto *sub = lookup<ArithFn>(*jit, std::string("sub") + suffix);
+    auto *mul = lookup<ArithFn>(*jit, std::string("mul") + suffix);
+
+    for (auto x : values) {
+      for (auto y : {int64_t{0}, int64_t{1}, int64_t{-3}, int64_t{1000}}) {
+        numOfSlowCalls = 0;
+
+        auto sum        = add(makeFixnum(x), makeFixnum(y));
+        auto difference = sub(makeFixnum(x), makeFixnum(y));
+        auto product    = mul(makeFixnum(x), makeFixnum(y));
+
+        CHECK(numOfSlowCalls == 0);
+        REQUIRE(isFixnum(sum));
+        REQUIRE(isFixnum(difference));
+        REQUIRE(isFixnum(product));
+        CHECK(getFixnum(sum) == x + y);
+        CHECK(getFixnum(difference) == x - y);
+        CHECK(getFixnum(product) == x * y);
+      }
+    }
+  }
+
+  auto *fmul = lookup<double(double, double)>(*jit, "fmul");
+  CHECK(fmul(1.5, 4) == 6);
+};
+
+TEST_CASE("The JIT'd arithmetic falls back to the runtime", "[jit]") {
+  auto jit = makeArithJIT();
+
+  for (const auto *suffix : {"", "Fixnum"}) {
+    auto *add = lookup<ArithFn>(*jit, std::string("add") + suffix);
+    auto *sub = lookup<ArithFn>(*jit, std::string("sub") + suffix);
+    auto *mul = lookup<ArithFn>(*jit, std::string("mul") + suffix);
+
+    numOfSlowCalls = 0;
+
+    // The overflow of a fixnum is boxed
+    auto sum = add(makeFixnum(SERENE_FIXNUM_MAX), makeFixnum(1));
+    CHECK_FALSE(isFixnum(sum));
+    CHECK(runtime::getInt(sum) == SERENE_FIXNUM_MAX + 1);
+
+    auto difference = sub(makeFixnum(SERENE_FIXNUM_MIN), makeFixnum(1));
+    CHECK_FALSE(isFixnum(difference));
+    CHECK(runtime::getInt(difference) == SERENE_FIXNUM_MIN - 1);
+
+    auto product =
+        mul(makeFixnum(SERENE_FIXNUM_MAX), makeFixnum(SERENE_FIXNUM_MAX));
+    CHECK(runtime::isBigInt(product));
+    CHECK(runtime::intToString(product) ==
+          "21267647932558653957237540927630737409");
+
+    CHECK(numOfSlowCalls == 3);
+  }
+
+  auto *add = lookup<ArithFn>(*jit, "add");
+  auto *sub = lookup<ArithFn>(*jit, "sub");
+
+  // The boxed operands always go to the runtime
+  numOfSlowCalls = 0;
+
+  auto sum = add(runtime::makeInt(INT64_MAX), makeFixnum(1));
+  CHECK(runtime::intToString(sum) == "9223372036854775808");
+
+  auto difference = sub(runtime::makeInt(SERENE_FIXNUM_MAX + 1), makeFixnum(1));
+  REQUIRE(isFixnum(difference));
+  CHECK(getFixnum(difference) == SERENE_FIXNUM_MAX);
+
+  CHECK(numOfSlowCalls == 2);
+};
+
+} // namespace serene::jit
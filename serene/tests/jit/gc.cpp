@@ -0,0 +1,233 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Commentary:
+ * The JIT'd code keeps the GC objects in its frames across the
+ * statepoints. These tests run a collection under a couple of JIT'd frames
+ * and check that the frames see the moved objects afterwards. They also
+ * count the calls to the slow path of the JIT'd allocations.
+ */
+
+#include "jit/utils.h"
+#include "runtime/gc.h"
+
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IRReader/IRReader.h>
+#include <llvm/Support/SourceMgr.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <vector>
+
+namespace serene::jit {
+
+/// `run` keeps a young object and a derived pointer into it across the
+/// safepoint and `outer` keeps another one in the frame above it.
+static const char *statepointsIR = R"(
+declare ptr addrspace(1) @testAlloc(i64)
+declare i64 @testRead(ptr addrspace(1))
+declare void @__serene_gc_safepoint()
+
+define i64 @run(i64 %n) gc "statepoint-example" {
+entry:
+  %a = call ptr addrspace(1) @testAlloc(i64 %n)
+  %b = call ptr addrspace(1) @testAlloc(i64 42)
+  %d = getelementptr i8, ptr addrspace(1) %a, i64 8
+  call void @__serene_gc_safepoint()
+  %x = call i64 @testRead(ptr addrspace(1) %a)
+  %y = call i64 @testRead(ptr addrspace(1) %b)
+  %z = load i64, ptr addrspace(1) %d
+  %s1 = add i64 %x, %y
+  %s = add i64 %s1, %z
+  ret i64 %s
+}
+
+define i64 @outer() gc "statepoint-example" {
+entry:
+  %o = call ptr addrspace(1) @testAlloc(i64 1000)
+  %r = call i64 @run(i64 7)
+  %v = call i64 @testRead(ptr addrspace(1) %o)
+  %s = add i64 %r, %v
+  ret i64 %s
+}
+)";
+
+static std::vector<int64_t *> allocatedObjects;
+static std::vector<int64_t *> readObjects;
+
+extern "C" int64_t *testAlloc(int64_t n) {
+  auto *ret = static_cast<int64_t *>(
+      runtime::allocate(2 * sizeof(int64_t), runtime::Layout::Raw));
+  ret[0] = n;
+  ret[1] = n * 10;
+  allocatedObjects.push_back(ret);
+  return ret;
+};
+
+extern "C" int64_t testRead(int64_t *object) {
+  readObjects.push_back(object);
+  return object[0];
+};
+
+TEST_CASE("A safepoint relocates the objects in the JIT'd frames", "[gc]") {
+  auto ctx = std::make_unique<llvm::LLVMContext>();
+  llvm::SMDiagnostic err;
+  auto m = llvm::parseIR(llvm::MemoryBufferRef(statepointsIR, "statepoints"),
+                         err, *ctx);
+  REQUIRE(m);
+
+  auto jit = makeTestJIT(
+      std::move(m), std::move(ctx),
+      {{"testAlloc", reinterpret_cast<void *>(&testAlloc)},
+       {"testRead", reinterpret_cast<void *>(&testRead)},
+       {"__serene_gc_safepoint",
+        reinterpret_cast<void *>(&__serene_gc_safepoint)}});
+  auto *outer = lookup<int64_t()>(*jit, "outer");
+
+  // Fill the nursery, so the safepoint collects
+  for (int i = 0; i < 200000; i++) {
+    runtime::allocate(32, runtime::Layout::Raw);
+  }
+
+  auto numOfMinorCollections = runtime::getGCStats().numOfMinorCollections;
+  int64_t result             = 0;
+  {
+    runtime::JITCall call;
+    result = outer();
+  }
+
+  CHECK(result == 7 + 42 + 70 + 1000);
+  CHECK(runtime::getGCStats().numOfMinorCollections ==
+        numOfMinorCollections + 1);
+
+  // Allocated `o`, `a` and `b` and read `a`, `b` and `o`
+  REQUIRE(allocatedObjects.size() == 3);
+  REQUIRE(readObjects.size() == 3);
+  CHECK(readObjects[0] != allocatedObjects[1]);
+  CHECK(readObjects[1] != allocatedObjects[2]);
+  CHECK(readObjects[2] != allocatedObjects[0]);
+};
+
+static uint64_t numOfSlowAllocations = 0;
+
+extern "C" void *countingAllocate(uint64_t size, uint8_t layout) {
+  numOfSlowAllocations++;
+  return __serene_gc_allocate(size, layout);
+};
+
+/// Build `buildList(n)` that allocates a list of the fixnums from zero to
+/// `n - 1` and returns its last node, and `allocateLarge()`. A node is the
+/// fixnum and the previous node.
+static std::unique_ptr<llvm::Module>
+makeAllocationModule(llvm::LLVMContext &ctx) {
+  auto m = std::make_unique<llvm::Module>("allocation", ctx);
+  llvm::IRBuilder<> builder(ctx);
+  auto *i64 = builder.getInt64Ty();
+  auto *ref = llvm::PointerType::get(ctx, GC_ADDRESS_SPACE);
+
+  auto *fn = llvm::Function::Create(llvm::FunctionType::get(ref, {i64}, false),
+                                    llvm::Function::ExternalLinkage,
+                                    "buildList", *m);
+  fn->setGC(GC_STRATEGY_NAME);
+  builder.SetInsertPoint(llvm::BasicBlock::Create(ctx, "entry", fn));
+
+  auto *tlab  = emitGetTLAB(builder);
+  auto *entry = builder.GetInsertBlock();
+  auto *loop  = llvm::BasicBlock::Create(ctx, "loop", fn);
+  auto *exit  = llvm::BasicBlock::Create(ctx, "exit", fn);
+  builder.CreateBr(loop);
+
+  builder.SetInsertPoint(loop);
+  auto *i    = builder.CreatePHI(i64, 2);
+  auto *prev = builder.CreatePHI(ref, 2);
+  i->addIncoming(builder.getInt64(0), entry);
+  prev->addIncoming(llvm::ConstantPointerNull::get(ref), entry);
+
+  auto *node = emitAllocation(builder, tlab, 2 * sizeof(uint64_t),
+                              runtime::Layout::Values);
+  builder.CreateStore(
+      builder.CreateOr(builder.CreateShl(i, 1), SERENE_FIXNUM_TAG), node);
+  builder.CreateStore(prev, builder.CreateConstInBoundsGEP1_64(
+                                builder.getInt8Ty(), node, sizeof(uint64_t)));
+
+  auto *next = builder.CreateAdd(i, builder.getInt64(1));
+  i->addIncoming(next, builder.GetInsertBlock());
+  prev->addIncoming(node, builder.GetInsertBlock());
+  builder.CreateCondBr(builder.CreateICmpULT(next, fn->getArg(0)), loop,
+                       exit);
+
+  builder.SetInsertPoint(exit);
+  builder.CreateRet(node);
+
+  fn = llvm::Function::Create(llvm::FunctionType::get(ref, false),
+                              llvm::Function::ExternalLinkage, "allocateLarge",
+                              *m);
+  fn->setGC(GC_STRATEGY_NAME);
+  builder.SetInsertPoint(llvm::BasicBlock::Create(ctx, "entry", fn));
+  builder.CreateRet(emitAllocation(builder, emitGetTLAB(builder),
+                                   2 * runtime::LARGE_OBJECT_SIZE,
+                                   runtime::Layout::Raw));
+  return m;
+};
+
+TEST_CASE("The JIT'd allocations only call the runtime to refill the TLAB",
+          "[gc]") {
+  auto ctx = std::make_unique<llvm::LLVMContext>();
+  auto m   = makeAllocationModule(*ctx);
+  auto jit = makeTestJIT(
+      std::move(m), std::move(ctx),
+      {{"__serene_gc_get_tlab",
+        reinterpret_cast<void *>(&__serene_gc_get_tlab)},
+       {"__serene_gc_allocate", reinterpret_cast<void *>(&countingAllocate)}});
+  auto *buildList     = lookup<uint64_t *(int64_t)>(*jit, "buildList");
+  auto *allocateLarge = lookup<void *()>(*jit, "allocateLarge");
+
+  // A collection resets the buffer, so the first allocation refills it
+  runtime::collect();
+  numOfSlowAllocations = 0;
+  buildList(1);
+  CHECK(numOfSlowAllocations == 1);
+
+  buildList(100);
+  CHECK(numOfSlowAllocations == 1);
+
+  // The 2.4MB of the nodes need a lot of the 32KB buffers
+  runtime::Root<uint64_t *> list(buildList(100000));
+  CHECK(numOfSlowAllocations > 50);
+
+  // The large objects never go through the buffer
+  numOfSlowAllocations = 0;
+  allocateLarge();
+  allocateLarge();
+  CHECK(numOfSlowAllocations == 2);
+
+  runtime::collect();
+
+  int64_t expected = 100000;
+  bool intact      = true;
+  auto *node       = list.get();
+  while (node != nullptr) {
+    intact = intact && getFixnum(node[0]) == --expected;
+    node   = reinterpret_cast<uint64_t *>(node[1]);
+  }
+  CHECK(intact);
+  CHECK(expected == 0);
+};
+
+} // namespace serene::jit
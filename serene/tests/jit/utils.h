@@ -0,0 +1,95 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Commentary:
+ * The tests of the generated code don't need the whole `serene::jit::JIT`.
+ * `makeTestJIT` sets up a bare LLJIT the same way, i.e. with the statepoint
+ * rewrite and the memory manager that registers the stack maps, and only
+ * links the runtime functions that the test hands to it.
+ */
+
+#ifndef TESTS_JIT_UTILS_H
+#define TESTS_JIT_UTILS_H
+
+#include "jit/gc.h"
+
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <memory>
+#include <utility>
+
+namespace serene::jit {
+
+/// Create a JIT with the module \p m in it. \p symbols are the runtime
+/// functions that the module calls by their names.
+inline std::unique_ptr<llvm::orc::LLJIT> makeTestJIT(
+    std::unique_ptr<llvm::Module> m, std::unique_ptr<llvm::LLVMContext> ctx,
+    llvm::ArrayRef<std::pair<llvm::StringRef, void *>> symbols) {
+  llvm::InitializeNativeTarget();
+  llvm::InitializeNativeTargetAsmPrinter();
+
+  REQUIRE_FALSE(llvm::verifyModule(*m, &llvm::errs()));
+
+  auto jit = llvm::cantFail(
+      llvm::orc::LLJITBuilder()
+          .setObjectLinkingLayerCreator([](llvm::orc::ExecutionSession &es,
+                                           const llvm::Triple &) {
+            return std::make_unique<llvm::orc::RTDyldObjectLinkingLayer>(
+                es, [] { return std::make_unique<GCMemoryManager>(); });
+          })
+          .create());
+
+  jit->getIRTransformLayer().setTransform(
+      [](llvm::orc::ThreadSafeModule tsm,
+         const llvm::orc::MaterializationResponsibility &)
+          -> llvm::Expected<llvm::orc::ThreadSafeModule> {
+        tsm.withModuleDo([](llvm::Module &m) { rewriteStatepoints(m); });
+        return tsm;
+      });
+
+  llvm::orc::SymbolMap map;
+  for (const auto &[name, fn] : symbols) {
+    map[jit->mangleAndIntern(name)] =
+        llvm::JITEvaluatedSymbol::fromPointer(fn);
+  }
+
+  auto &jd = jit->getMainJITDylib();
+  llvm::cantFail(jd.define(llvm::orc::absoluteSymbols(std::move(map))));
+  llvm::cantFail(jit->addIRModule(
+      llvm::orc::ThreadSafeModule(std::move(m), std::move(ctx))));
+  return jit;
+};
+
+/// Return the JIT'd function \p name of the type `Fn`
+template <typename Fn>
+Fn *lookup(llvm::orc::LLJIT &jit, llvm::StringRef name) {
+  return llvm::cantFail(jit.lookup(name)).toPtr<Fn *>();
+};
+
+} // namespace serene::jit
+
+#endif
@@ -0,0 +1,114 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Commentary:
+ * The streaming reader has to return the same forms no matter how the input
+ * is split into chunks.
+ */
+
+#include "reader.h"
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include <string>
+
+namespace serene {
+
+/// Feed the given \p input to a `StreamReader` in chunks of \p chunkSize
+/// chars and return the printed forms and the number of errors.
+static std::pair<std::string, size_t> feedInChunks(llvm::StringRef input,
+                                                   size_t chunkSize) {
+  StreamReader r("user", std::nullopt);
+  std::string result;
+
+  auto print = [&](ast::Ast forms) {
+    for (auto &form : forms) {
+      result += form->toString() + " ";
+    }
+  };
+
+  for (size_t i = 0; i < input.size(); i += chunkSize) {
+    print(r.feed(input.substr(i, chunkSize)));
+  }
+  print(r.finish());
+
+  return {result, r.takeErrors().size()};
+};
+
+TEST_CASE("StreamReader keeps a quote prefix with its form", "[reader]") {
+  StreamReader r("user", std::nullopt);
+
+  auto forms = r.feed("'(a b");
+  CHECK(forms.empty());
+  CHECK(r.needsMoreInput());
+
+  forms = r.feed(")\n");
+  REQUIRE(forms.size() == 1);
+  CHECK(forms[0]->toString() ==
+        "<List <Symbol user/quote>, <List <Symbol user/a>, <Symbol user/b>>>");
+  CHECK(r.takeErrors().empty());
+};
+
+TEST_CASE("StreamReader needs more input only inside of a form",
+          "[reader]") {
+  auto [input, needsMore] = GENERATE(table<llvm::StringRef, bool>({
+      {"(def a 1)\n", false},
+      {"   \n", false},
+      {"(def a", true},
+      {"\"abc", true},
+      {"'", true},
+      {"#| abc", true},
+      {"(def a 1) ; abc", true},
+      {"(def a 1) ; abc\n", false},
+  }));
+
+  StreamReader r("user", std::nullopt);
+  r.feed(input);
+  CHECK(r.needsMoreInput() == needsMore);
+};
+
+TEST_CASE("StreamReader doesn't depend on the chunk sizes", "[reader]") {
+  auto input = GENERATE(llvm::StringRef("'(a b)\n"),
+                        llvm::StringRef("`[1 ~@(x) ,y]\n"),
+                        llvm::StringRef("~@ ;; comment\n #| block |# (z)\n"),
+                        llvm::StringRef("' \"s\" 'sym ~a\n"),
+                        llvm::StringRef("(a) '\n(b)\n"));
+
+  auto [expected, errors] = feedInChunks(input, input.size());
+  CHECK(errors == 0);
+
+  for (size_t size = 1; size < input.size(); size++) {
+    INFO("Chunk size: " << size);
+    CHECK(feedInChunks(input, size) == std::make_pair(expected, size_t{0}));
+  }
+};
+
+TEST_CASE("StreamReader keeps the good forms around a broken one",
+          "[reader]") {
+  StreamReader r("user", std::nullopt);
+
+  auto forms = r.feed("(def a 1) )\n");
+  REQUIRE(forms.size() == 1);
+  CHECK(forms[0]->toString() ==
+        "<List <Symbol user/def>, <Symbol user/a>, <Number 1>>");
+  CHECK(r.takeErrors().size() == 1);
+};
+
+} // namespace serene
@@ -0,0 +1,160 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Commentary:
+ * The collector moves the young objects, so these tests check that the
+ * references to them are updated rather than that the objects stay alive.
+ * The nursery is reused after each minor collection, so a stale reference
+ * would point to whatever `scribble` allocated in there.
+ */
+
+#include "runtime/gc.h"
+#include "runtime/list.h"
+#include "runtime/map.h"
+#include "runtime/number.h"
+#include "runtime/vector.h"
+
+#include <llvm/ADT/SmallVector.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstring>
+
+namespace serene::runtime {
+
+/// Fill the nursery with garbage
+static void scribble() {
+  for (int i = 0; i < 1000; i++) {
+    memset(allocate(64, Layout::Raw), 0xAB, 64);
+  }
+};
+
+/// A boxed int, so it's a young object of its own
+static Value makeBoxed(int64_t i) { return makeInt(INT64_MAX - i); };
+
+TEST_CASE("A minor collection moves the young objects of the roots", "[gc]") {
+  llvm::SmallVector<Value, 100> elements;
+  for (int64_t i = 0; i < 100; i++) {
+    elements.push_back(makeBoxed(i));
+  }
+
+  Root<Value> boxed(makeBoxed(0));
+  Root<Vector> v(makeVector(elements));
+  Root<List> l(makeList(elements));
+  Root<Map> m(emptyMap());
+
+  for (int64_t i = 0; i < 100; i++) {
+    m.get() = assoc(m.get(), makeBoxed(i), makeInt(i));
+  }
+
+  auto oldBoxed  = boxed.get();
+  auto *oldRoot  = v->root;
+  auto *oldTail  = v->tail;
+  auto *oldChunk = l->chunk;
+  auto *oldNode  = m->root;
+
+  auto numOfMinorCollections = getGCStats().numOfMinorCollections;
+
+  collect();
+  scribble();
+
+  CHECK(getGCStats().numOfMinorCollections == numOfMinorCollections + 1);
+  CHECK(boxed.get() != oldBoxed);
+  CHECK(v->root != oldRoot);
+  CHECK(v->tail != oldTail);
+  CHECK(l->chunk != oldChunk);
+  CHECK(m->root != oldNode);
+
+  CHECK(getInt(boxed.get()) == INT64_MAX);
+
+  REQUIRE(v->len == 100);
+  REQUIRE(l->len == 100);
+  REQUIRE(size(m.get()) == 100);
+
+  auto tail = l.get();
+  for (int64_t i = 0; i < 100; i++) {
+    CHECK(getInt(nth(v.get(), i)) == INT64_MAX - i);
+    CHECK(getInt(first(tail)) == INT64_MAX - i);
+    tail = rest(tail);
+
+    const auto *value = lookup(m.get(), makeBoxed(i));
+    REQUIRE(value != nullptr);
+    CHECK(getInt(*value) == i);
+  }
+};
+
+TEST_CASE("The write barrier keeps the young objects of the old ones alive",
+          "[gc]") {
+  auto *slots =
+      static_cast<Value *>(allocate(2 * sizeof(Value), Layout::Values));
+  slots[0] = SERENE_NIL;
+  slots[1] = SERENE_NIL;
+
+  Root<Value *> old(slots);
+  // The first collection promotes the slots and old objects never move
+  collect();
+  auto *promoted = old.get();
+
+  writeBarrier(old.get());
+  old.get()[0] = makeBoxed(0);
+  auto young = old.get()[0];
+
+  collect();
+  scribble();
+
+  CHECK(old.get() == promoted);
+  CHECK(old.get()[0] != young);
+  CHECK(getInt(old.get()[0]) == INT64_MAX);
+  CHECK(isNil(old.get()[1]));
+};
+
+TEST_CASE("A major collection frees the unreachable large objects", "[gc]") {
+  constexpr size_t objectSize = 4 * LARGE_OBJECT_SIZE;
+
+  collect(true);
+  auto before = getGCStats().oldBytes;
+
+  Root<uint64_t *> kept(
+      static_cast<uint64_t *>(allocate(objectSize, Layout::Raw)));
+  for (size_t i = 0; i < objectSize / sizeof(uint64_t); i++) {
+    kept.get()[i] = i;
+  }
+
+  for (int i = 0; i < 10; i++) {
+    allocate(objectSize, Layout::Raw);
+  }
+
+  // The large objects go directly to the old generation
+  auto allocated = getGCStats().oldBytes;
+  REQUIRE(allocated >= before + (11 * objectSize));
+
+  collect(true);
+
+  auto after = getGCStats().oldBytes;
+  CHECK(allocated - after >= 10 * objectSize);
+  CHECK(after >= before + objectSize);
+
+  bool intact = true;
+  for (size_t i = 0; i < objectSize / sizeof(uint64_t); i++) {
+    intact = intact && kept.get()[i] == i;
+  }
+  CHECK(intact);
+};
+
+} // namespace serene::runtime
@@ -0,0 +1,201 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Commentary:
+ * A CHAMP trie is canonical, i.e. the same set of keys always ends up in
+ * the same shape no matter how it was built. `getShape` prints the bitmaps
+ * of the nodes, so the tests can compare the shapes of two maps.
+ *
+ * `hashValue` mixes the int of a boxed number just like the bits of a
+ * fixnum, so a fixnum and the boxed int with the same bits as its tagged
+ * word have the same hash. That's how these tests get the collision nodes.
+ */
+
+#include "runtime/map.h"
+#include "runtime/number.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <string>
+
+namespace serene::runtime {
+
+/// Print the shape of the trie under \p node
+static std::string getShape(const MapNode *node) {
+  std::string ret = "(" + std::to_string(node->dataMap) + " " +
+                    std::to_string(node->nodeMap) + " " +
+                    std::to_string(node->numOfEntries);
+
+  // The children are after the hashes, the keys and the values
+  const auto *nodes = reinterpret_cast<const MapNode *const *>(
+      node->slots + (3 * node->entryCapacity));
+
+  for (unsigned i = 0; i < node->numOfNodes; i++) {
+    ret += " " + getShape(nodes[i]);
+  }
+
+  return ret + ")";
+};
+
+/// Return the depth of the deepest node under \p node
+static unsigned getDepth(const MapNode *node) {
+  const auto *nodes = reinterpret_cast<const MapNode *const *>(
+      node->slots + (3 * node->entryCapacity));
+
+  unsigned ret = 0;
+  for (unsigned i = 0; i < node->numOfNodes; i++) {
+    ret = std::max(ret, getDepth(nodes[i]) + 1);
+  }
+
+  return ret;
+};
+
+static Map makeMap(int64_t from, int64_t to, int64_t step = 1) {
+  auto m = emptyMap();
+  for (auto i = from; i < to; i += step) {
+    m = assoc(m, makeFixnum(i), makeFixnum(-i));
+  }
+  return m;
+};
+
+static bool hasRange(const Map &m, int64_t from, int64_t to,
+                     int64_t step = 1) {
+  bool ret = true;
+  for (auto i = from; i < to; i += step) {
+    const auto *value = lookup(m, makeFixnum(i));
+    ret               = ret && value != nullptr && *value == makeFixnum(-i);
+  }
+  return ret;
+};
+
+TEST_CASE("dissoc leaves the map in its canonical shape", "[map]") {
+  auto all = makeMap(0, 2000);
+
+  auto odds = all;
+  for (int64_t i = 0; i < 2000; i += 2) {
+    odds = dissoc(odds, makeFixnum(i));
+  }
+
+  REQUIRE(size(odds) == 1000);
+  CHECK(hasRange(odds, 1, 2000, 2));
+  CHECK(lookup(odds, makeFixnum(0)) == nullptr);
+  CHECK(getShape(odds.root) == getShape(makeMap(1, 2000, 2).root));
+
+  // The same through a transient
+  TransientMap t(all);
+  for (int64_t i = 0; i < 2000; i += 2) {
+    t.dissoc(makeFixnum(i));
+  }
+  auto p = t.persistent();
+  CHECK(getShape(p.root) == getShape(odds.root));
+
+  // Down to a single entry in the root
+  auto last = odds;
+  for (int64_t i = 3; i < 2000; i += 2) {
+    last = dissoc(last, makeFixnum(i));
+  }
+  REQUIRE(size(last) == 1);
+  CHECK(getShape(last.root) == getShape(makeMap(1, 2).root));
+
+  CHECK(size(all) == 2000);
+  CHECK(hasRange(all, 0, 2000));
+};
+
+TEST_CASE("The keys with the same hash share a collision node", "[map]") {
+  // The tagged words of the fixnums are the ints of the boxes
+  const std::pair<Value, Value> collisions[] = {
+      {makeFixnum(SERENE_FIXNUM_MAX), makeInt(INT64_MAX)},
+      {makeFixnum(SERENE_FIXNUM_MIN), makeInt(INT64_MIN + 1)},
+  };
+
+  for (const auto &[a, b] : collisions) {
+    REQUIRE(hashValue(a) == hashValue(b));
+    REQUIRE_FALSE(equalValues(a, b));
+
+    auto m = makeMap(0, 100);
+    m      = assoc(m, a, makeFixnum(1));
+    m      = assoc(m, b, makeFixnum(2));
+
+    REQUIRE(size(m) == 102);
+    CHECK(*lookup(m, a) == makeFixnum(1));
+    CHECK(*lookup(m, b) == makeFixnum(2));
+    CHECK(hasRange(m, 0, 100));
+
+    // A collision node is below all the 64 bits of the hash
+    CHECK(getDepth(m.root) == 13);
+
+    // Another box of the same int is the same key
+    auto replaced = assoc(m, makeInt(getInt(b)), makeFixnum(3));
+    CHECK(size(replaced) == 102);
+    CHECK(*lookup(replaced, b) == makeFixnum(3));
+    CHECK(*lookup(m, b) == makeFixnum(2));
+
+    // Removing one of them pulls the other one back up to the root
+    auto removed = dissoc(m, b);
+    CHECK(size(removed) == 101);
+    CHECK(lookup(removed, b) == nullptr);
+    CHECK(*lookup(removed, a) == makeFixnum(1));
+    CHECK(getShape(removed.root) ==
+          getShape(assoc(makeMap(0, 100), a, makeFixnum(1)).root));
+
+    TransientMap t(m);
+    t.dissoc(a);
+    t.assoc(b, makeFixnum(4));
+    auto p = t.persistent();
+    CHECK(size(p) == 101);
+    CHECK(*lookup(p, b) == makeFixnum(4));
+    CHECK(*lookup(m, a) == makeFixnum(1));
+    CHECK(*lookup(m, b) == makeFixnum(2));
+  }
+};
+
+TEST_CASE("A transient never changes the persistent maps", "[map]") {
+  auto m = makeMap(0, 1000);
+
+  TransientMap t(m);
+  for (int64_t i = 0; i < 1000; i++) {
+    t.assoc(makeFixnum(i), makeFixnum(i));
+  }
+  for (int64_t i = 0; i < 1000; i += 3) {
+    t.dissoc(makeFixnum(i));
+  }
+  CHECK(t.size() == 666);
+  CHECK(hasRange(m, 0, 1000));
+
+  auto p = t.persistent();
+
+  TransientMap t2(p);
+  for (int64_t i = 1000; i < 2000; i++) {
+    t2.assoc(makeFixnum(i), makeFixnum(-i));
+  }
+  for (int64_t i = 1; i < 1000; i += 3) {
+    t2.dissoc(makeFixnum(i));
+  }
+
+  auto p2 = t2.persistent();
+  CHECK(size(p2) == 1333);
+  CHECK(hasRange(p2, 1000, 2000));
+  CHECK(size(p) == 666);
+  CHECK(*lookup(p, makeFixnum(1)) == makeFixnum(1));
+  CHECK(size(m) == 1000);
+  CHECK(hasRange(m, 0, 1000));
+};
+
+} // namespace serene::runtime
@@ -0,0 +1,184 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Commentary:
+ * The products of the big ints are checked against a plain long
+ * multiplication of their decimal digits, so the tests don't depend on
+ * either of the algorithms of `mul`. A limb holds a bit more than 19
+ * decimal digits.
+ */
+
+#include "runtime/number.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace serene::runtime {
+
+/// Return \p n random decimal digits without any leading zero
+static std::string makeDigits(std::mt19937_64 &rng, size_t n) {
+  std::string ret(n, '0');
+  for (auto &c : ret) {
+    c = static_cast<char>('0' + (rng() % 10));
+  }
+  ret[0] = static_cast<char>('1' + (rng() % 9));
+  return ret;
+};
+
+/// Multiply the decimal magnitudes \p a and \p b digit by digit
+static std::string multiplyDigits(const std::string &a, const std::string &b) {
+  std::vector<uint32_t> digits(a.size() + b.size(), 0);
+
+  for (size_t i = a.size(); i-- > 0;) {
+    uint32_t carry = 0;
+    for (size_t j = b.size(); j-- > 0;) {
+      auto &d = digits[i + j + 1];
+      d += static_cast<uint32_t>(a[i] - '0') *
+               static_cast<uint32_t>(b[j] - '0') +
+           carry;
+      carry = d / 10;
+      d %= 10;
+    }
+    digits[i] += carry;
+  }
+
+  std::string ret;
+  for (auto d : digits) {
+    if (!ret.empty() || d != 0) {
+      ret += static_cast<char>('0' + d);
+    }
+  }
+  return ret.empty() ? "0" : ret;
+};
+
+TEST_CASE("mul agrees with the long multiplication around the Karatsuba "
+          "threshold",
+          "[number]") {
+  std::mt19937_64 rng(KARATSUBA_THRESHOLD);
+
+  // The number of digits for about the given number of limbs
+  auto limbs = [](size_t n) { return n * 19; };
+
+  const std::pair<size_t, size_t> sizes[] = {
+      {1, 1},
+      {2, limbs(KARATSUBA_THRESHOLD - 1)},
+      {limbs(KARATSUBA_THRESHOLD - 1), limbs(KARATSUBA_THRESHOLD - 1)},
+      {limbs(KARATSUBA_THRESHOLD) + 1, limbs(KARATSUBA_THRESHOLD) + 1},
+      {limbs(KARATSUBA_THRESHOLD + 1), limbs(KARATSUBA_THRESHOLD + 7)},
+      {limbs(3 * KARATSUBA_THRESHOLD), limbs(3 * KARATSUBA_THRESHOLD)},
+      // The unbalanced products
+      {limbs(KARATSUBA_THRESHOLD + 1), limbs(5 * KARATSUBA_THRESHOLD)},
+      {limbs(8 * KARATSUBA_THRESHOLD), limbs(2 * KARATSUBA_THRESHOLD) + 5},
+  };
+
+  for (const auto &[aSize, bSize] : sizes) {
+    auto a = makeDigits(rng, aSize);
+    auto b = makeDigits(rng, bSize);
+
+    auto expected = multiplyDigits(a, b);
+
+    CHECK(intToString(mul(parseInt(a), parseInt(b))) == expected);
+    CHECK(intToString(mul(parseInt(b), parseInt(a))) == expected);
+    CHECK(intToString(mul(parseInt("-" + a), parseInt(b))) ==
+          "-" + expected);
+    CHECK(intToString(mul(parseInt("-" + a), parseInt("-" + b))) ==
+          expected);
+  }
+
+  auto a = parseInt(makeDigits(rng, limbs(4 * KARATSUBA_THRESHOLD)));
+  CHECK(intToString(mul(a, makeInt(0))) == "0");
+  CHECK(intToString(mul(a, makeInt(1))) == intToString(a));
+};
+
+TEST_CASE("parseInt and intToString round trip", "[number]") {
+  const char *digits[] = {
+      "0",
+      "-1",
+      "999999999999999999",
+      "1000000000000000000",
+      "9999999999999999999",
+      "10000000000000000000",
+      "-10000000000000000001",
+      "100000000000000000000000000000000000000",
+      "99999999999999999999999999999999999999",
+      "1000000000000000000100000000000000000010000000000000000001",
+      "-123456789012345678901234567890123456789012345678901234567890",
+  };
+
+  for (const auto *s : digits) {
+    CHECK(intToString(parseInt(s)) == s);
+  }
+
+  CHECK(intToString(parseInt("000")) == "0");
+  CHECK(intToString(parseInt("-0")) == "0");
+  CHECK(intToString(parseInt("0000000000000000000000000012345")) == "12345");
+  CHECK(intToString(parseInt("-000000000000000000000012345678901234567890")) ==
+        "-12345678901234567890");
+};
+
+TEST_CASE("The ints at the edges of int64 only box when they have to",
+          "[number]") {
+  auto max = parseInt("9223372036854775807");
+  REQUIRE_FALSE(isBigInt(max));
+  CHECK(getInt(max) == INT64_MAX);
+
+  auto min = parseInt("-9223372036854775808");
+  REQUIRE_FALSE(isBigInt(min));
+  CHECK(getInt(min) == INT64_MIN);
+
+  CHECK(isBigInt(parseInt("9223372036854775808")));
+  CHECK(isBigInt(parseInt("-9223372036854775809")));
+
+  CHECK(intToString(makeInt(INT64_MAX)) == "9223372036854775807");
+  CHECK(intToString(makeInt(INT64_MIN)) == "-9223372036854775808");
+};
+
+TEST_CASE("The overflows of int64 promote to big ints and back", "[number]") {
+  auto sum = add(makeInt(INT64_MAX), makeInt(1));
+  REQUIRE(isBigInt(sum));
+  CHECK(intToString(sum) == "9223372036854775808");
+
+  auto back = sub(sum, makeInt(1));
+  REQUIRE_FALSE(isBigInt(back));
+  CHECK(getInt(back) == INT64_MAX);
+
+  auto difference = sub(makeInt(INT64_MIN), makeInt(1));
+  REQUIRE(isBigInt(difference));
+  CHECK(intToString(difference) == "-9223372036854775809");
+  CHECK(getInt(add(difference, makeInt(1))) == INT64_MIN);
+
+  auto product = mul(makeInt(INT64_MIN), makeInt(-1));
+  REQUIRE(isBigInt(product));
+  CHECK(intToString(product) == "9223372036854775808");
+
+  auto square = mul(makeInt(INT64_MAX), makeInt(INT64_MAX));
+  REQUIRE(isBigInt(square));
+  CHECK(intToString(square) == "85070591730234615847396907784232501249");
+
+  // The results that fit in a fixnum are not boxed at all
+  CHECK(isFixnum(sub(square, square)));
+  CHECK(isFixnum(mul(square, makeInt(0))));
+  CHECK(isFixnum(sub(makeInt(SERENE_FIXNUM_MAX + 1), makeInt(1))));
+  CHECK(getInt(sub(back, makeInt(INT64_MAX - 5))) == 5);
+};
+
+} // namespace serene::runtime
@@ -0,0 +1,153 @@
+/* -*- C++ -*-
+ * Serene Programming Language
+ *
+ * Copyright (c) 2019-2023 Sameer Rahmani <lxsameer@gnu.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Commentary:
+ * The elements of these vectors are the fixnums of their indices (plus an
+ * offset), so any element that ends up at the wrong place, or any change
+ * that leaks into an older version, shows up in `isRange`.
+ */
+
+#include "runtime/vector.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <vector>
+
+namespace serene::runtime {
+
+/// The length of a vector with a full tail and a full trie under a root at
+/// the given \p shift
+static constexpr uint32_t getFullLength(uint32_t shift) {
+  return SERENE_VECTOR_WIDTH + (1U << (shift + SERENE_VECTOR_BITS));
+};
+
+/// Whether \p v is the fixnums from \p offset to `offset + len - 1`
+static bool isRange(const Vector &v, uint32_t len, int64_t offset = 0) {
+  if (v.len != len) {
+    return false;
+  }
+
+  int64_t expected = offset;
+  bool ret         = true;
+  forEachSpan(v, [&](llvm::ArrayRef<Value> span) {
+    for (auto x : span) {
+      ret = ret && x == makeFixnum(expected++);
+    }
+  });
+
+  for (uint32_t i = 0; i < len; i++) {
+    ret = ret && nth(v, i) == makeFixnum(offset + i);
+  }
+
+  return ret && expected == offset + len;
+};
+
+TEST_CASE("conj grows the trie across the root overflows", "[vector]") {
+  // The lengths around the tail and the root overflows
+  const uint32_t boundaries[] = {SERENE_VECTOR_WIDTH, SERENE_VECTOR_WIDTH + 1,
+                                 getFullLength(5),    getFullLength(5) + 1,
+                                 getFullLength(10),   getFullLength(10) + 1};
+
+  std::vector<Vector> versions;
+  auto v = emptyVector();
+
+  for (auto boundary : boundaries) {
+    while (v.len < boundary) {
+      v = conj(v, makeFixnum(v.len));
+    }
+    versions.push_back(v);
+  }
+
+  CHECK(versions[2].shift == 5);
+  CHECK(versions[3].shift == 10);
+  CHECK(versions[4].shift == 10);
+  CHECK(versions[5].shift == 15);
+
+  // The older versions share the nodes but they never change
+  for (unsigned i = 0; i < versions.size(); i++) {
+    CHECK(isRange(versions[i], boundaries[i]));
+  }
+};
+
+TEST_CASE("assoc copies either the tail or the path in the trie",
+          "[vector]") {
+  const uint32_t len = 100;
+
+  auto v = emptyVector();
+  while (v.len < len) {
+    v = conj(v, makeFixnum(v.len));
+  }
+  REQUIRE(getTailOffset(v) == 96);
+
+  auto inTail = assoc(v, 98, makeFixnum(-1));
+  CHECK(inTail.root == v.root);
+  CHECK(inTail.tail != v.tail);
+  CHECK(nth(inTail, 98) == makeFixnum(-1));
+
+  auto inTrie = assoc(v, 5, makeFixnum(-1));
+  CHECK(inTrie.root != v.root);
+  CHECK(inTrie.tail == v.tail);
+  CHECK(nth(inTrie, 5) == makeFixnum(-1));
+
+  // Assoc at the length is a conj
+  auto appended = assoc(v, len, makeFixnum(len));
+  CHECK(isRange(appended, len + 1));
+
+  CHECK(isRange(v, len));
+};
+
+TEST_CASE("A transient never changes the persistent vectors", "[vector]") {
+  const uint32_t len = getFullLength(5) + 10;
+
+  auto v = emptyVector();
+  while (v.len < len) {
+    v = conj(v, makeFixnum(v.len));
+  }
+
+  TransientVector t(v);
+  for (uint32_t i = 0; i < len; i++) {
+    t.assoc(i, makeFixnum(i + 1000));
+  }
+  for (uint32_t i = len; i < 2 * len; i++) {
+    t.conj(makeFixnum(i + 1000));
+  }
+  CHECK(t.nth(0) == makeFixnum(1000));
+  CHECK(isRange(v, len));
+
+  auto p = t.persistent();
+  CHECK(isRange(p, 2 * len, 1000));
+
+  // A new transient of the persistent vector copies the nodes again
+  TransientVector t2(p);
+  for (uint32_t i = 0; i < 2 * len; i++) {
+    t2.assoc(i, makeFixnum(i));
+  }
+  t2.conj(makeFixnum(2 * len));
+
+  CHECK(isRange(t2.persistent(), (2 * len) + 1));
+  CHECK(isRange(p, 2 * len, 1000));
+  CHECK(isRange(v, len));
+
+  // And so do the persistent operations
+  auto q = assoc(p, 0, makeFixnum(0));
+  CHECK(nth(q, 0) == makeFixnum(0));
+  CHECK(isRange(p, 2 * len, 1000));
+};
+
+} // namespace serene::runtime